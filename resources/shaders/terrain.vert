@@ -1,16 +1,74 @@
 #version 330 core
 
-layout(location = 0) in vec4 in_pos_block;
-layout(location = 1) in vec2 in_uv;
+// one `hi::FaceRecord` per face, 4 vertices per face
+uniform usamplerBuffer faces;
 
 uniform mat4 projection;
 uniform mat4 view;
+uniform vec3 chunk_origin;
+uniform float tiles_per_row;
 
 out vec2 frag_uv;
-out float block_info;
+flat out vec2 frag_tile;
+flat out float frag_light;
+out float frag_ao;
+
+// BL, BR, TR, TL of each face, in `Block::CUBE_POS` order
+const vec3 CORNERS[24] = vec3[24](
+    vec3(0, 0, 1), vec3(1, 0, 1), vec3(1, 1, 1), vec3(0, 1, 1), // z+
+    vec3(1, 0, 0), vec3(0, 0, 0), vec3(0, 1, 0), vec3(1, 1, 0), // z-
+    vec3(0, 0, 0), vec3(0, 0, 1), vec3(0, 1, 1), vec3(0, 1, 0), // x-
+    vec3(1, 0, 1), vec3(1, 0, 0), vec3(1, 1, 0), vec3(1, 1, 1), // x+
+    vec3(0, 1, 1), vec3(1, 1, 1), vec3(1, 1, 0), vec3(0, 1, 0), // y+
+    vec3(0, 0, 0), vec3(1, 0, 0), vec3(1, 0, 1), vec3(0, 0, 1)  // y-
+);
+
+// texture axes per face
+const vec3 FACE_U[6] = vec3[6](vec3(1, 0, 0), vec3(-1, 0, 0), vec3(0, 0, 1),
+                               vec3(0, 0, -1), vec3(1, 0, 0), vec3(1, 0, 0));
+const vec3 FACE_V[6] = vec3[6](vec3(0, 1, 0), vec3(0, 1, 0), vec3(0, 1, 0),
+                               vec3(0, 1, 0), vec3(0, 0, -1), vec3(0, 0, 1));
 
 void main() {
-    frag_uv = in_uv;
-    block_info = in_pos_block.w; // transfer .w as float
-    gl_Position = projection * view * vec4(in_pos_block.xyz, 1.0);
+    uint face_index = uint(gl_VertexID) >> 2;
+    uint corner = uint(gl_VertexID) & 3u;
+
+    uvec2 record = texelFetch(faces, int(face_index)).xy;
+    uint position_size = record.x;
+    uint tile_light = record.y;
+
+    // split the quad along the other diagonal when BL/TR are darker, so
+    // the occlusion fades evenly instead of streaking across the face
+    uint ao_bits = (tile_light >> 16) & 0xFFu;
+    if ((ao_bits & 3u) + ((ao_bits >> 4) & 3u) >
+        ((ao_bits >> 2) & 3u) + ((ao_bits >> 6) & 3u))
+        corner = (corner + 1u) & 3u;
+
+    vec3 base = vec3(float(position_size & 31u),
+                     float((position_size >> 5) & 31u),
+                     float((position_size >> 10) & 31u));
+    uint face = (position_size >> 15) & 7u;
+    if (face > 5u) { // `FaceRecord::empty`, collapsed to nothing
+        gl_Position = vec4(0.0);
+        return;
+    }
+    float w = float(((position_size >> 18) & 31u) + 1u);
+    float h = float(((position_size >> 23) & 31u) + 1u);
+
+    // stretch the unit face along its texture axes
+    vec3 size = vec3(1.0);
+    size[face == 2u || face == 3u ? 2 : 0] = w;
+    size[face == 4u || face == 5u ? 2 : 1] = h;
+    vec3 pos = base + CORNERS[face * 4u + corner] * size;
+
+    uint tile = tile_light & 0xFFFu;
+    uint light = (tile_light >> 12) & 0xFu;
+    uint ao = (tile_light >> (16u + corner * 2u)) & 3u;
+    uint tpr = uint(tiles_per_row);
+
+    frag_uv = vec2(dot(pos, FACE_U[face]), dot(pos, FACE_V[face]));
+    frag_tile = vec2(float(tile % tpr), float(tile / tpr));
+    frag_light = float(light);
+    frag_ao = float(ao);
+    gl_Position = projection * view * vec4(chunk_origin + pos, 1.0);
 }
@@ -0,0 +1,163 @@
+#include "job_system.hpp"
+
+#include <algorithm>
+#include <cstdio>
+
+namespace hi {
+
+// the pool and queue of the calling worker thread
+static thread_local const JobSystem *current_pool = nullptr;
+static thread_local unsigned current_queue = 0;
+
+// a thread per CPU, so that the count can go up to it at runtime
+static unsigned thread_capacity(unsigned worker_count) noexcept {
+    return std::max({worker_count, std::thread::hardware_concurrency(), 1u});
+}
+
+JobSystem::JobSystem(unsigned worker_count) noexcept
+    : queues{std::make_unique<Queue[]>(thread_capacity(worker_count))},
+      active{std::max(worker_count, 1u)} {
+    const unsigned capacity = thread_capacity(worker_count);
+    workers.reserve(capacity);
+    for (unsigned i = 0; i < capacity; ++i)
+        workers.emplace_back([this, i] { run(i); });
+}
+
+JobSystem::~JobSystem() noexcept {
+    running.store(false);
+    change_settings();
+    for (auto &worker : workers)
+        if (worker.joinable())
+            worker.join();
+}
+
+void JobSystem::set_worker_count(unsigned count) noexcept {
+    active.store(std::clamp(count, 1u, max_workers()));
+    change_settings();
+}
+
+void JobSystem::set_affinity(unsigned long long mask) noexcept {
+    cpu_mask.store(mask);
+    change_settings();
+}
+
+void JobSystem::set_priority(ThreadPriority priority) noexcept {
+    thread_priority.store(priority);
+    change_settings();
+}
+
+void JobSystem::change_settings() noexcept {
+    // waiting workers look again, parked ones as well in case they were
+    // left out of `active`
+    settings_epoch.fetch_add(1);
+    settings_epoch.notify_all();
+    wake_epoch.fetch_add(1);
+    wake_epoch.notify_all();
+}
+
+void JobSystem::submit(Lane lane, Job job) noexcept {
+    // outside jobs only go to the workers taking them
+    const unsigned index =
+        (current_pool == this)
+            ? current_queue
+            : next_queue.fetch_add(1, std::memory_order_relaxed) %
+                  worker_count();
+
+    // counted before it is published, so that the worker taking it never
+    // decrements first; pairs with the re-check in `run`: either the
+    // parking worker sees the job, or this sees the worker parked
+    pending.fetch_add(1);
+    {
+        std::lock_guard lk(queues[index].mutex);
+        queues[index].jobs[lane].push_back(std::move(job));
+    }
+    if (parked.load()) {
+        wake_epoch.fetch_add(1);
+        wake_epoch.notify_one();
+    }
+}
+
+bool JobSystem::take_job(unsigned index, Job &out) noexcept {
+    if (!pending.load(std::memory_order_relaxed))
+        return false;
+
+    const unsigned count = max_workers(); // steals from the waiting ones
+    for (unsigned lane = 0; lane < LANES; ++lane) {
+        {
+            Queue &own = queues[index];
+            std::lock_guard lk(own.mutex);
+            if (!own.jobs[lane].empty()) {
+                out = std::move(own.jobs[lane].front());
+                own.jobs[lane].pop_front();
+                pending.fetch_sub(1);
+                return true;
+            }
+        }
+        for (unsigned i = 1; i < count; ++i) {
+            Queue &victim = queues[(index + i) % count];
+            std::lock_guard lk(victim.mutex);
+            if (!victim.jobs[lane].empty()) {
+                out = std::move(victim.jobs[lane].back());
+                victim.jobs[lane].pop_back();
+                pending.fetch_sub(1);
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+void JobSystem::run(unsigned index) noexcept {
+    current_pool = this;
+    current_queue = index;
+
+    Job job;
+    unsigned idle = 0;
+    uint32_t applied = 0; // the defaults of a new thread
+    ThreadPriority priority = ThreadPriority::Normal;
+    while (running.load()) {
+        const uint32_t settings_seen = settings_epoch.load();
+        if (settings_seen != applied) {
+            applied = settings_seen;
+            if (!set_thread_affinity(cpu_mask.load()) && index == 0)
+                fprintf(stderr, "[WARNING] Worker affinity not applied\n");
+
+            // refused: all workers go back to the priority this one kept,
+            // unless another change came in meanwhile
+            ThreadPriority wanted = thread_priority.load();
+            if (set_thread_priority(wanted)) {
+                priority = wanted;
+            } else if (thread_priority.compare_exchange_strong(wanted,
+                                                               priority)) {
+                fprintf(stderr, "[WARNING] Worker priority refused\n");
+                change_settings();
+            }
+        }
+        if (index >= active.load()) {
+            if (running.load())
+                settings_epoch.wait(settings_seen);
+            continue;
+        }
+
+        if (take_job(index, job)) {
+            job();
+            job = nullptr;
+            idle = 0;
+            continue;
+        }
+        if (++idle < SPINS_BEFORE_PARKING) {
+            std::this_thread::yield();
+            continue;
+        }
+
+        // park until a submission moves the epoch
+        const uint32_t epoch = wake_epoch.load();
+        parked.fetch_add(1);
+        if (!pending.load() && running.load() && index < active.load())
+            wake_epoch.wait(epoch);
+        parked.fetch_sub(1);
+        idle = 0;
+    }
+}
+
+} // namespace hi
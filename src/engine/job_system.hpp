@@ -0,0 +1,97 @@
+#pragma once
+
+#include "../higui/platform.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace hi {
+
+/* Work-stealing thread pool.
+   Every worker owns one deque per priority lane. A worker serves a lane
+   from its own deque first and steals from the others' before it looks at
+   a lower lane, so the lanes hold across the pool. Owners take from the
+   front and keep the submission order, thieves take from the back.
+   Jobs submitted from outside the pool are spread over the workers round
+   robin, jobs submitted by a worker stay on its own deque.
+   Idle workers spin briefly, then park on an atomic; a submission wakes
+   one of them only when some are parked.
+   A thread per CPU is started up front, and only the first `worker_count`
+   of them take jobs; the rest wait for the settings to change, while the
+   jobs left on their deques are stolen. Workers apply the affinity and
+   the priority to themselves when they notice a change; a priority one of
+   them is refused is rolled back for all of them. */
+struct JobSystem {
+    enum Lane : unsigned { High, Normal, Low, LANES };
+    using Job = std::function<void()>;
+
+    explicit JobSystem(unsigned worker_count) noexcept;
+    ~JobSystem() noexcept; // drops the jobs which did not start
+
+    JobSystem(const JobSystem &) = delete;
+    JobSystem &operator=(const JobSystem &) = delete;
+
+    void submit(Lane lane, Job job) noexcept;
+
+    // clamped to 1..max_workers
+    void set_worker_count(unsigned count) noexcept;
+    // a bit per CPU the workers may run on, 0 for all of them
+    void set_affinity(unsigned long long cpu_mask) noexcept;
+    /* Raising it back usually needs privileges: when a worker is refused,
+       the workers go back to the priority it kept and `priority` reports
+       that one, once the workers noticed. */
+    void set_priority(ThreadPriority priority) noexcept;
+
+    unsigned worker_count() const noexcept {
+        return active.load(std::memory_order_relaxed);
+    }
+    unsigned max_workers() const noexcept { return unsigned(workers.size()); }
+    unsigned long long affinity() const noexcept {
+        return cpu_mask.load(std::memory_order_relaxed);
+    }
+    ThreadPriority priority() const noexcept {
+        return thread_priority.load(std::memory_order_relaxed);
+    }
+    // bumped by every settings change
+    uint32_t settings() const noexcept {
+        return settings_epoch.load(std::memory_order_relaxed);
+    }
+    // submitted and not started yet
+    size_t queued() const noexcept {
+        return pending.load(std::memory_order_relaxed);
+    }
+
+  private:
+    struct alignas(64) Queue {
+        std::mutex mutex;
+        std::deque<Job> jobs[LANES];
+    }; // struct Queue
+
+    static constexpr unsigned SPINS_BEFORE_PARKING = 64;
+
+    std::unique_ptr<Queue[]> queues;
+    std::vector<std::thread> workers;
+
+    std::atomic<size_t> pending = 0;
+    std::atomic<unsigned> active = 0; // workers taking jobs
+    std::atomic<unsigned long long> cpu_mask = 0;
+    std::atomic<ThreadPriority> thread_priority = ThreadPriority::Normal;
+    // workers out of `active` wait on it
+    std::atomic<uint32_t> settings_epoch = 0;
+    std::atomic<unsigned> parked = 0;
+    std::atomic<uint32_t> wake_epoch = 0; // parked workers wait on it
+    std::atomic<unsigned> next_queue = 0; // round robin for outside jobs
+    std::atomic<bool> running = true;
+
+    void run(unsigned index) noexcept;
+    void change_settings() noexcept;
+    bool take_job(unsigned index, Job &out) noexcept;
+}; // struct JobSystem
+
+} // namespace hi
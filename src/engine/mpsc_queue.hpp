@@ -0,0 +1,76 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <utility>
+
+namespace hi {
+
+/* Lock-free queue of many producers and one consumer.
+   Producers push a node onto an intrusive stack with one CAS; the consumer
+   takes the whole stack with one exchange and reverses it, so items come
+   out in the order they were pushed. The consumer never takes single
+   nodes, which leaves no ABA problem for the producers. `depth` is a
+   gauge: exact once the producers are done, otherwise a close estimate. */
+template <typename T> struct MpscQueue {
+    MpscQueue() noexcept = default;
+    ~MpscQueue() noexcept { clear(); }
+
+    MpscQueue(const MpscQueue &) = delete;
+    MpscQueue &operator=(const MpscQueue &) = delete;
+
+    // from any thread
+    void push(T value) noexcept {
+        Node *node = new Node{nullptr, std::move(value)};
+        count.fetch_add(1, std::memory_order_relaxed);
+        node->next = head.load(std::memory_order_relaxed);
+        while (!head.compare_exchange_weak(node->next, node,
+                                           std::memory_order_release,
+                                           std::memory_order_relaxed)) {
+        }
+    }
+
+    /* Consumer only: calls `fn(T &&)` on every item pushed so far, oldest
+       first, and returns the count of them. */
+    template <typename Fn> size_t consume_all(Fn &&fn) noexcept {
+        Node *node = head.exchange(nullptr, std::memory_order_acquire);
+        Node *oldest = nullptr;
+        while (node) {
+            Node *next = node->next;
+            node->next = oldest;
+            oldest = node;
+            node = next;
+        }
+
+        size_t taken = 0;
+        while (oldest) {
+            Node *next = oldest->next;
+            fn(std::move(oldest->value));
+            delete oldest;
+            oldest = next;
+            ++taken;
+        }
+        count.fetch_sub(taken, std::memory_order_relaxed);
+        return taken;
+    }
+
+    // consumer only
+    void clear() noexcept {
+        consume_all([](T &&) {});
+    }
+
+    size_t depth() const noexcept {
+        return count.load(std::memory_order_relaxed);
+    }
+
+  private:
+    struct Node {
+        Node *next;
+        T value;
+    }; // struct Node
+
+    alignas(64) std::atomic<Node *> head = nullptr; // the newest
+    std::atomic<size_t> count = 0;
+}; // struct MpscQueue
+
+} // namespace hi
@@ -146,7 +146,7 @@ PFNGLCOMPILESHADERPROC glad_glCompileShader = nullptr;
 // PFNGLCOMPRESSEDTEXSUBIMAGE1DPROC glad_glCompressedTexSubImage1D = nullptr;
 // PFNGLCOMPRESSEDTEXSUBIMAGE2DPROC glad_glCompressedTexSubImage2D = nullptr;
 // PFNGLCOMPRESSEDTEXSUBIMAGE3DPROC glad_glCompressedTexSubImage3D = nullptr;
-// PFNGLCOPYBUFFERSUBDATAPROC glad_glCopyBufferSubData = nullptr;
+PFNGLCOPYBUFFERSUBDATAPROC glad_glCopyBufferSubData = nullptr;
 // PFNGLCOPYIMAGESUBDATAPROC glad_glCopyImageSubData = nullptr;
 // PFNGLCOPYPIXELSPROC glad_glCopyPixels = nullptr;
 // PFNGLCOPYTEXIMAGE1DPROC glad_glCopyTexImage1D = nullptr;
@@ -175,7 +175,7 @@ PFNGLDELETETEXTURESPROC glad_glDeleteTextures = nullptr;
 // PFNGLDELETETRANSFORMFEEDBACKSPROC glad_glDeleteTransformFeedbacks = nullptr;
 PFNGLDELETEVERTEXARRAYSPROC glad_glDeleteVertexArrays = nullptr;
 // PFNGLDEPTHFUNCPROC glad_glDepthFunc = nullptr;
-// PFNGLDEPTHMASKPROC glad_glDepthMask = nullptr;
+PFNGLDEPTHMASKPROC glad_glDepthMask = nullptr;
 // PFNGLDEPTHRANGEPROC glad_glDepthRange = nullptr;
 // PFNGLDEPTHRANGEARRAYVPROC glad_glDepthRangeArrayv = nullptr;
 // PFNGLDEPTHRANGEINDEXEDPROC glad_glDepthRangeIndexed = nullptr;
@@ -195,7 +195,7 @@ PFNGLDRAWARRAYSPROC glad_glDrawArrays = nullptr;
 // PFNGLDRAWBUFFERPROC glad_glDrawBuffer = nullptr;
 // PFNGLDRAWBUFFERSPROC glad_glDrawBuffers = nullptr;
 PFNGLDRAWELEMENTSPROC glad_glDrawElements = nullptr;
-// PFNGLDRAWELEMENTSBASEVERTEXPROC glad_glDrawElementsBaseVertex = nullptr;
+PFNGLDRAWELEMENTSBASEVERTEXPROC glad_glDrawElementsBaseVertex = nullptr;
 // PFNGLDRAWELEMENTSINDIRECTPROC glad_glDrawElementsIndirect = nullptr;
 // PFNGLDRAWELEMENTSINSTANCEDPROC glad_glDrawElementsInstanced = nullptr;
 // PFNGLDRAWELEMENTSINSTANCEDBASEINSTANCEPROC
@@ -312,7 +312,7 @@ PFNGLGETFLOATVPROC glad_glGetFloatv = nullptr;
 // nullptr; PFNGLGETINTEGER64I_VPROC glad_glGetInteger64i_v = nullptr;
 // PFNGLGETINTEGER64VPROC glad_glGetInteger64v = nullptr;
 // PFNGLGETINTEGERI_VPROC glad_glGetIntegeri_v = nullptr;
-// PFNGLGETINTEGERVPROC glad_glGetIntegerv = nullptr;
+PFNGLGETINTEGERVPROC glad_glGetIntegerv = nullptr;
 // PFNGLGETINTERNALFORMATI64VPROC glad_glGetInternalformati64v = nullptr;
 // PFNGLGETINTERNALFORMATIVPROC glad_glGetInternalformativ = nullptr;
 // PFNGLGETLIGHTFVPROC glad_glGetLightfv = nullptr;
@@ -707,7 +707,7 @@ PFNGLSHADERSOURCEPROC glad_glShaderSource = nullptr;
 // PFNGLSTENCILMASKSEPARATEPROC glad_glStencilMaskSeparate = nullptr;
 // PFNGLSTENCILOPPROC glad_glStencilOp = nullptr;
 // PFNGLSTENCILOPSEPARATEPROC glad_glStencilOpSeparate = nullptr;
-// PFNGLTEXBUFFERPROC glad_glTexBuffer = nullptr;
+PFNGLTEXBUFFERPROC glad_glTexBuffer = nullptr;
 // PFNGLTEXBUFFERRANGEPROC glad_glTexBufferRange = nullptr;
 // PFNGLTEXCOORD1DPROC glad_glTexCoord1d = nullptr;
 // PFNGLTEXCOORD1DVPROC glad_glTexCoord1dv = nullptr;
@@ -784,7 +784,7 @@ PFNGLTEXPARAMETERIPROC glad_glTexParameteri = nullptr;
 // nullptr; PFNGLTRANSLATEDPROC glad_glTranslated = nullptr; PFNGLTRANSLATEFPROC
 // glad_glTranslatef = nullptr; PFNGLUNIFORM1DPROC glad_glUniform1d = nullptr;
 // PFNGLUNIFORM1DVPROC glad_glUniform1dv = nullptr;
-// PFNGLUNIFORM1FPROC glad_glUniform1f = nullptr;
+PFNGLUNIFORM1FPROC glad_glUniform1f = nullptr;
 // PFNGLUNIFORM1FVPROC glad_glUniform1fv = nullptr;
 PFNGLUNIFORM1IPROC glad_glUniform1i = nullptr;
 // PFNGLUNIFORM1IVPROC glad_glUniform1iv = nullptr;
@@ -800,7 +800,7 @@ PFNGLUNIFORM1IPROC glad_glUniform1i = nullptr;
 // PFNGLUNIFORM2UIVPROC glad_glUniform2uiv = nullptr;
 // PFNGLUNIFORM3DPROC glad_glUniform3d = nullptr;
 // PFNGLUNIFORM3DVPROC glad_glUniform3dv = nullptr;
-// PFNGLUNIFORM3FPROC glad_glUniform3f = nullptr;
+PFNGLUNIFORM3FPROC glad_glUniform3f = nullptr;
 // PFNGLUNIFORM3FVPROC glad_glUniform3fv = nullptr;
 // PFNGLUNIFORM3IPROC glad_glUniform3i = nullptr;
 // PFNGLUNIFORM3IVPROC glad_glUniform3iv = nullptr;
@@ -997,8 +997,8 @@ static void load_GL_VERSION_1_0(GLADloadproc load) {
     // (PFNGLCLEARSTENCILPROC)load("glClearStencil"); glad_glClearDepth =
     // (PFNGLCLEARDEPTHPROC)load("glClearDepth"); glad_glStencilMask =
     // (PFNGLSTENCILMASKPROC)load("glStencilMask"); glad_glColorMask =
-    // (PFNGLCOLORMASKPROC)load("glColorMask"); glad_glDepthMask =
-    // (PFNGLDEPTHMASKPROC)load("glDepthMask");
+    // (PFNGLCOLORMASKPROC)load("glColorMask");
+    glad_glDepthMask = (PFNGLDEPTHMASKPROC)load("glDepthMask");
     glad_glDisable = (PFNGLDISABLEPROC)load("glDisable");
     glad_glEnable = (PFNGLENABLEPROC)load("glEnable");
     // glad_glFinish = (PFNGLFINISHPROC)load("glFinish"); // glad_glFlush =
@@ -1017,8 +1017,7 @@ static void load_GL_VERSION_1_0(GLADloadproc load) {
     // (PFNGLGETDOUBLEVPROC)load("glGetDoublev"); glad_glGetError =
     // (PFNGLGETERRORPROC)load("glGetError");
     glad_glGetFloatv = (PFNGLGETFLOATVPROC)load("glGetFloatv");
-    // glad_glGetIntegerv =
-    // (PFNGLGETINTEGERVPROC)load("glGetIntegerv");
+    glad_glGetIntegerv = (PFNGLGETINTEGERVPROC)load("glGetIntegerv");
     glad_glGetString = (PFNGLGETSTRINGPROC)load("glGetString");
     // glad_glGetTexImage =
     // (PFNGLGETTEXIMAGEPROC)load("glGetTexImage"); glad_glGetTexParameterfv =
@@ -1601,9 +1600,9 @@ static void load_GL_VERSION_2_0(GLADloadproc load) {
     glad_glLinkProgram = (PFNGLLINKPROGRAMPROC)load("glLinkProgram");
     glad_glShaderSource = (PFNGLSHADERSOURCEPROC)load("glShaderSource");
     glad_glUseProgram = (PFNGLUSEPROGRAMPROC)load("glUseProgram");
-    // glad_glUniform1f = (PFNGLUNIFORM1FPROC)load("glUniform1f");
+    glad_glUniform1f = (PFNGLUNIFORM1FPROC)load("glUniform1f");
     // glad_glUniform2f = (PFNGLUNIFORM2FPROC)load("glUniform2f");
-    // glad_glUniform3f = (PFNGLUNIFORM3FPROC)load("glUniform3f");
+    glad_glUniform3f = (PFNGLUNIFORM3FPROC)load("glUniform3f");
     // glad_glUniform4f = (PFNGLUNIFORM4FPROC)load("glUniform4f");
     glad_glUniform1i = (PFNGLUNIFORM1IPROC)load("glUniform1i");
     // glad_glUniform2i = (PFNGLUNIFORM2IPROC)load("glUniform2i");
@@ -1873,11 +1872,11 @@ static void load_GL_VERSION_3_1(GLADloadproc load) {
     //     (PFNGLDRAWARRAYSINSTANCEDPROC)load("glDrawArraysInstanced");
     // glad_glDrawElementsInstanced =
     //     (PFNGLDRAWELEMENTSINSTANCEDPROC)load("glDrawElementsInstanced");
-    // glad_glTexBuffer = (PFNGLTEXBUFFERPROC)load("glTexBuffer");
+    glad_glTexBuffer = (PFNGLTEXBUFFERPROC)load("glTexBuffer");
     // glad_glPrimitiveRestartIndex =
     //     (PFNGLPRIMITIVERESTARTINDEXPROC)load("glPrimitiveRestartIndex");
-    // glad_glCopyBufferSubData =
-    //     (PFNGLCOPYBUFFERSUBDATAPROC)load("glCopyBufferSubData");
+    glad_glCopyBufferSubData =
+        (PFNGLCOPYBUFFERSUBDATAPROC)load("glCopyBufferSubData");
     // glad_glGetUniformIndices =
     //     (PFNGLGETUNIFORMINDICESPROC)load("glGetUniformIndices");
     // glad_glGetActiveUniformsiv =
@@ -1900,8 +1899,8 @@ static void load_GL_VERSION_3_1(GLADloadproc load) {
 }
 
 static void load_GL_VERSION_3_2(GLADloadproc load) {
-    // glad_glDrawElementsBaseVertex =
-    //    (PFNGLDRAWELEMENTSBASEVERTEXPROC)load("glDrawElementsBaseVertex");
+    glad_glDrawElementsBaseVertex =
+        (PFNGLDRAWELEMENTSBASEVERTEXPROC)load("glDrawElementsBaseVertex");
     // glad_glDrawRangeElementsBaseVertex =
     //     (PFNGLDRAWRANGEELEMENTSBASEVERTEXPROC)load(
     //         "glDrawRangeElementsBaseVertex");
@@ -1943,9 +1943,9 @@ GLAPI PFNGLCLEARCOLORPROC glad_glClearColor;
 //                                            GLboolean blue, GLboolean alpha);
 // GLAPI PFNGLCOLORMASKPROC glad_glColorMask;
 // #define glColorMask glad_glColorMask
-// typedef void(APIENTRYP PFNGLDEPTHMASKPROC)(GLboolean flag);
-// GLAPI PFNGLDEPTHMASKPROC glad_glDepthMask;
-// #define glDepthMask glad_glDepthMask
+typedef void(APIENTRYP PFNGLDEPTHMASKPROC)(GLboolean flag);
+GLAPI PFNGLDEPTHMASKPROC glad_glDepthMask;
+#define glDepthMask glad_glDepthMask
 typedef void(APIENTRYP PFNGLDISABLEPROC)(GLenum cap);
 GLAPI PFNGLDISABLEPROC glad_glDisable;
 #define glDisable glad_glDisable
@@ -2001,9 +2001,9 @@ GLAPI PFNGLBLENDFUNCPROC glad_glBlendFunc;
 typedef void(APIENTRYP PFNGLGETFLOATVPROC)(GLenum pname, GLfloat *data);
 GLAPI PFNGLGETFLOATVPROC glad_glGetFloatv;
 #define glGetFloatv glad_glGetFloatv
-// typedef void(APIENTRYP PFNGLGETINTEGERVPROC)(GLenum pname, GLint *data);
-// GLAPI PFNGLGETINTEGERVPROC glad_glGetIntegerv;
-// #define glGetIntegerv glad_glGetIntegerv
+typedef void(APIENTRYP PFNGLGETINTEGERVPROC)(GLenum pname, GLint *data);
+GLAPI PFNGLGETINTEGERVPROC glad_glGetIntegerv;
+#define glGetIntegerv glad_glGetIntegerv
 typedef const GLubyte *(APIENTRYP PFNGLGETSTRINGPROC)(GLenum name);
 GLAPI PFNGLGETSTRINGPROC glad_glGetString;
 #define glGetString glad_glGetString
@@ -3682,17 +3682,17 @@ GLAPI PFNGLSHADERSOURCEPROC glad_glShaderSource;
 typedef void(APIENTRYP PFNGLUSEPROGRAMPROC)(GLuint program);
 GLAPI PFNGLUSEPROGRAMPROC glad_glUseProgram;
 #define glUseProgram glad_glUseProgram
-// typedef void(APIENTRYP PFNGLUNIFORM1FPROC)(GLint location, GLfloat v0);
-// GLAPI PFNGLUNIFORM1FPROC glad_glUniform1f;
-// #define glUniform1f glad_glUniform1f
+typedef void(APIENTRYP PFNGLUNIFORM1FPROC)(GLint location, GLfloat v0);
+GLAPI PFNGLUNIFORM1FPROC glad_glUniform1f;
+#define glUniform1f glad_glUniform1f
 // typedef void(APIENTRYP PFNGLUNIFORM2FPROC)(GLint location, GLfloat v0,
 //                                            GLfloat v1);
 // GLAPI PFNGLUNIFORM2FPROC glad_glUniform2f;
 // #define glUniform2f glad_glUniform2f
-// typedef void(APIENTRYP PFNGLUNIFORM3FPROC)(GLint location, GLfloat v0,
-//                                            GLfloat v1, GLfloat v2);
-// GLAPI PFNGLUNIFORM3FPROC glad_glUniform3f;
-// #define glUniform3f glad_glUniform3f
+typedef void(APIENTRYP PFNGLUNIFORM3FPROC)(GLint location, GLfloat v0,
+                                           GLfloat v1, GLfloat v2);
+GLAPI PFNGLUNIFORM3FPROC glad_glUniform3f;
+#define glUniform3f glad_glUniform3f
 // typedef void(APIENTRYP PFNGLUNIFORM4FPROC)(GLint location, GLfloat v0,
 //                                            GLfloat v1, GLfloat v2, GLfloat
 //                                            v3);
@@ -4338,21 +4338,21 @@ GLAPI PFNGLGENVERTEXARRAYSPROC glad_glGenVertexArrays;
 //                                                        instancecount);
 // GLAPI PFNGLDRAWELEMENTSINSTANCEDPROC glad_glDrawElementsInstanced;
 // #define glDrawElementsInstanced glad_glDrawElementsInstanced
-// typedef void(APIENTRYP PFNGLTEXBUFFERPROC)(GLenum target, GLenum
-// internalformat,
-//                                            GLuint buffer);
-// GLAPI PFNGLTEXBUFFERPROC glad_glTexBuffer;
-// #define glTexBuffer glad_glTexBuffer
+typedef void(APIENTRYP PFNGLTEXBUFFERPROC)(GLenum target,
+                                           GLenum internalformat,
+                                           GLuint buffer);
+GLAPI PFNGLTEXBUFFERPROC glad_glTexBuffer;
+#define glTexBuffer glad_glTexBuffer
 // typedef void(APIENTRYP PFNGLPRIMITIVERESTARTINDEXPROC)(GLuint index);
 // GLAPI PFNGLPRIMITIVERESTARTINDEXPROC glad_glPrimitiveRestartIndex;
 // #define glPrimitiveRestartIndex glad_glPrimitiveRestartIndex
-// typedef void(APIENTRYP PFNGLCOPYBUFFERSUBDATAPROC)(GLenum readTarget,
-//                                                    GLenum writeTarget,
-//                                                    GLintptr readOffset,
-//                                                    GLintptr writeOffset,
-//                                                    GLsizeiptr size);
-// GLAPI PFNGLCOPYBUFFERSUBDATAPROC glad_glCopyBufferSubData;
-// #define glCopyBufferSubData glad_glCopyBufferSubData
+typedef void(APIENTRYP PFNGLCOPYBUFFERSUBDATAPROC)(GLenum readTarget,
+                                                   GLenum writeTarget,
+                                                   GLintptr readOffset,
+                                                   GLintptr writeOffset,
+                                                   GLsizeiptr size);
+GLAPI PFNGLCOPYBUFFERSUBDATAPROC glad_glCopyBufferSubData;
+#define glCopyBufferSubData glad_glCopyBufferSubData
 // typedef void(APIENTRYP PFNGLGETUNIFORMINDICESPROC)(
 //     GLuint program, GLsizei uniformCount, const GLchar *const *uniformNames,
 //     GLuint *uniformIndices);
@@ -4393,13 +4393,13 @@ GLAPI PFNGLGENVERTEXARRAYSPROC glad_glGenVertexArrays;
 #ifndef GL_VERSION_3_2
 #define GL_VERSION_3_2 1
 
-// typedef void(APIENTRYP PFNGLDRAWELEMENTSBASEVERTEXPROC)(GLenum mode,
-//                                                         GLsizei count,
-//                                                         GLenum type,
-//                                                         const void *indices,
-//                                                         GLint basevertex);
-// GLAPI PFNGLDRAWELEMENTSBASEVERTEXPROC glad_glDrawElementsBaseVertex;
-// #define glDrawElementsBaseVertex glad_glDrawElementsBaseVertex
+typedef void(APIENTRYP PFNGLDRAWELEMENTSBASEVERTEXPROC)(GLenum mode,
+                                                        GLsizei count,
+                                                        GLenum type,
+                                                        const void *indices,
+                                                        GLint basevertex);
+GLAPI PFNGLDRAWELEMENTSBASEVERTEXPROC glad_glDrawElementsBaseVertex;
+#define glDrawElementsBaseVertex glad_glDrawElementsBaseVertex
 // typedef void(APIENTRYP PFNGLDRAWRANGEELEMENTSBASEVERTEXPROC)(
 //     GLenum mode, GLuint start, GLuint end, GLsizei count, GLenum type,
 //     const void *indices, GLint basevertex);
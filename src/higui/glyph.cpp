@@ -90,8 +90,8 @@ static inline int vsnprintf(char *str, size_t size, const char *format,
 }
 
 extern "C" inline const char *vformat(const char *fmt, va_list args) {
-    static char buffer[256]; // Not thread-safe. Ensure to change `static` to
-                             // `thread_local`
+    // Not thread-safe. Ensure to change `static` to `thread_local`
+    static char buffer[TextRenderer::MAX_CHARS + 1];
     vsnprintf(buffer, sizeof(buffer), fmt, args);
     return buffer;
 }
@@ -29,7 +29,7 @@ struct TextRenderer {
     int text_atlas_location = 0;
 
     static constexpr int FONT_ASCENT = 16;
-    static constexpr int MAX_CHARS = 256;
+    static constexpr int MAX_CHARS = 512; // the debug overlay takes ~300
     static constexpr int FLOATS_PER_VERTEX = 4; // x, y, u, v
     static constexpr int VERTS_PER_CHAR = 4;
     static constexpr int INDS_PER_CHAR = 6;
@@ -9,9 +9,12 @@
 #include <X11/Xlib.h>
 #include <X11/Xutil.h>
 
+#include <pthread.h>
+#include <sched.h>
 #include <stdint.h>
 #include <string.h>
 #include <sys/mman.h>
+#include <sys/resource.h>
 #include <time.h>
 #include <unistd.h>
 
@@ -81,6 +84,34 @@ double calculate_delta_time() noexcept {
     last_time = current_time;
     return delta;
 }
+
+bool set_thread_affinity(unsigned long long cpu_mask) noexcept {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (unsigned cpu = 0; cpu < CPU_SETSIZE; ++cpu)
+        if (!cpu_mask || (cpu < 64 && (cpu_mask >> cpu) & 1))
+            CPU_SET(cpu, &set);
+    return !pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+}
+
+bool set_thread_priority(ThreadPriority priority) noexcept {
+    sched_param param{};
+    const int previous = sched_getscheduler(0);
+    const int policy =
+        priority == ThreadPriority::Idle ? SCHED_IDLE : SCHED_OTHER;
+    if (sched_setscheduler(0, policy, &param) < 0)
+        return false;
+    if (priority == ThreadPriority::Idle)
+        return true; // `nice` does not matter to idle threads
+    // `nice` is per thread on Linux; lowering it needs privileges, and
+    // the thread goes back to its policy when refused
+    const int nice = priority == ThreadPriority::Low ? 10 : 0;
+    if (setpriority(PRIO_PROCESS, gettid(), nice) == 0)
+        return true;
+    if (previous >= 0)
+        sched_setscheduler(0, previous, &param);
+    return false;
+}
 } // namespace hi
 
 namespace hi::window {
@@ -41,6 +41,19 @@ double time() noexcept;
 // returns time in seconds for previous draw call
 double calculate_delta_time() noexcept;
 
+enum class ThreadPriority : unsigned char {
+    Normal,
+    Low,  // below the main thread, `nice` 10 on Linux
+    Idle, // only when nothing else runs, `SCHED_IDLE` on Linux
+};
+
+// For the calling thread: `cpu_mask` has a bit per CPU, 0 allows all.
+// `false` if the OS refused
+bool set_thread_affinity(unsigned long long cpu_mask) noexcept;
+// raising it back may need privileges the process does not have; `false`
+// and the thread keeps the priority it had when refused
+bool set_thread_priority(ThreadPriority priority) noexcept;
+
 // ===== Contains all info related to crossplatform window management =====
 namespace window {
 Handler create(const Callback *, GraphicsContext &, int width,
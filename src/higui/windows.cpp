@@ -142,6 +142,23 @@ void panic(Result result) noexcept {
 }
 
 void sleep(unsigned ms) noexcept { Sleep(ms); }
+
+bool set_thread_affinity(unsigned long long cpu_mask) noexcept {
+    DWORD_PTR process_mask = 0, system_mask = 0;
+    if (!cpu_mask &&
+        GetProcessAffinityMask(GetCurrentProcess(), &process_mask,
+                               &system_mask))
+        cpu_mask = process_mask;
+    return SetThreadAffinityMask(GetCurrentThread(), DWORD_PTR(cpu_mask)) != 0;
+}
+
+bool set_thread_priority(ThreadPriority priority) noexcept {
+    const int level = priority == ThreadPriority::Idle ? THREAD_PRIORITY_IDLE
+                      : priority == ThreadPriority::Low
+                          ? THREAD_PRIORITY_BELOW_NORMAL
+                          : THREAD_PRIORITY_NORMAL;
+    return SetThreadPriority(GetCurrentThread(), level) != 0;
+}
 } // namespace hi
 
 namespace hi::window {
@@ -1,10 +1,53 @@
 #include "engine/engine.hpp"
 
+#include <cstdlib>
+#include <cstring>
+
 inline static bool show_debug_menu = false;
 
+static const char *stream_shape_name(hi::StreamShape shape) noexcept {
+    switch (shape) {
+    case hi::StreamShape::Octahedron:
+        return "octahedron";
+    case hi::StreamShape::Sphere:
+        return "sphere";
+    case hi::StreamShape::Cylinder:
+        return "cylinder";
+    }
+    return "?";
+}
+
+static const char *priority_name(hi::ThreadPriority priority) noexcept {
+    switch (priority) {
+    case hi::ThreadPriority::Normal:
+        return "normal";
+    case hi::ThreadPriority::Low:
+        return "low";
+    case hi::ThreadPriority::Idle:
+        return "idle";
+    }
+    return "?";
+}
+
+/* Worker settings from the environment, for tuning per machine:
+   ECHOLYPS_WORKERS=3, ECHOLYPS_AFFINITY=0xfe (a bit per CPU),
+   ECHOLYPS_PRIORITY=normal|low|idle */
+static void configure_workers(hi::JobSystem &jobs) noexcept {
+    if (const char *workers = getenv("ECHOLYPS_WORKERS"))
+        jobs.set_worker_count(unsigned(strtoul(workers, nullptr, 10)));
+    if (const char *affinity = getenv("ECHOLYPS_AFFINITY"))
+        jobs.set_affinity(strtoull(affinity, nullptr, 0));
+    if (const char *priority = getenv("ECHOLYPS_PRIORITY")) {
+        for (int i = 0; i <= int(hi::ThreadPriority::Idle); ++i)
+            if (!strcmp(priority, priority_name(hi::ThreadPriority(i))))
+                jobs.set_priority(hi::ThreadPriority(i));
+    }
+}
+
 void hi::Engine::start() noexcept {
     surface.set_title("Your Echolyps");
     text.init(font.font_bitmap);
+    configure_workers(world.terrain.jobs);
 }
 
 void hi::Engine::update() noexcept {
@@ -31,21 +74,72 @@ void hi::Engine::update() noexcept {
         avg_fps += fps_history[i];
     avg_fps /= fps_count;
 
+    // chunks generated per second of streaming since the worker settings
+    // last changed
+    const hi::JobSystem &jobs = world.terrain.jobs;
+    static uint32_t rate_settings = jobs.settings();
+    static size_t rate_chunks = 0;
+    static double rate_seconds = 0.0;
+    const size_t generated = world.terrain.generated_chunks.load();
+    if (jobs.settings() != rate_settings) {
+        rate_settings = jobs.settings();
+        rate_chunks = generated;
+        rate_seconds = 0.0;
+    } else if (jobs.queued()) {
+        rate_seconds += dt;
+    }
+    const float chunks_per_second =
+        rate_seconds > 0.0 ? float((generated - rate_chunks) / rate_seconds)
+                           : 0.f;
+
     // Render debug menu in the game
     if (show_debug_menu) {
         simple_timer += dt;
         if (simple_timer > 0.1f) {
-            text.add_text(-0.93f, 0.9f, 0.003f,
-                          "x %f y %f z %f\n"
-                          "fps: %d (avg: %d)\n"
-                          "delta: %f ms\n",
-                          world.camera.position[0],      // x
-                          world.camera.position[1],      // y
-                          world.camera.position[2],      // z
-                          static_cast<int>(current_fps), // fps
-                          static_cast<int>(avg_fps),     // fps (average)
-                          static_cast<float>(dt) * 1000  // delta time
-            );
+            // free space the largest free range does not cover
+            const hi::FaceArena &arena = world.terrain.arena;
+            const hi::FaceArena::Stats faces = arena.stats();
+            const float fragmented =
+                faces.free ? 100.f * float(faces.free - faces.largest_free) /
+                                 float(faces.free)
+                           : 0.f;
+            char cpus[24] = "all";
+            if (jobs.affinity())
+                snprintf(cpus, sizeof(cpus), "0x%llx", jobs.affinity());
+            text.add_text(
+                -0.93f, 0.9f, 0.003f,
+                "x %f y %f z %f\n"
+                "fps: %d (avg: %d)\n"
+                "delta: %f ms\n"
+                "faces: %d (%s), drawn %d\n"
+                "face pages: %d, %d MiB, %d ranges free, %d%% fragmented\n"
+                "jobs: %d queued, %d cancelled\n"
+                "meshes: %d ready, %d to upload\n"
+                "workers: %d/%d, %s, cpus %s: %d chunks/s\n"
+                "stream: %s, holes in view: %d\n",
+                world.camera.position[0],      // x
+                world.camera.position[1],      // y
+                world.camera.position[2],      // z
+                static_cast<int>(current_fps), // fps
+                static_cast<int>(avg_fps),     // fps (average)
+                static_cast<float>(dt) * 1000, // delta time
+                static_cast<int>(world.terrain.loaded_faces), // terrain faces
+                world.terrain.greedy_meshing ? "greedy" : "faces",
+                static_cast<int>(world.terrain.drawn_faces), // after culling
+                static_cast<int>(arena.page_count()),
+                static_cast<int>(arena.reserved_bytes() >> 20),
+                static_cast<int>(faces.free_ranges),
+                static_cast<int>(fragmented),
+                static_cast<int>(world.terrain.jobs.queued()),
+                static_cast<int>(world.terrain.cancelled_jobs.load()),
+                static_cast<int>(world.terrain.ready.depth()),
+                static_cast<int>(world.terrain.uploads.size()),
+                static_cast<int>(jobs.worker_count()),
+                static_cast<int>(jobs.max_workers()),
+                priority_name(jobs.priority()), cpus,
+                static_cast<int>(chunks_per_second),
+                stream_shape_name(world.terrain.stream_shape),
+                static_cast<int>(world.terrain.frustum_holes()));
             text.upload();
             simple_timer = 0.f;
         }
@@ -88,6 +182,7 @@ void hi::Engine::update() noexcept {
         world.update_pos();
         world.camera.look_at(world.view);
     }
+    world.track_motion(dt);
 }
 
 void hi::Engine::draw() const noexcept {
@@ -102,6 +197,30 @@ void hi::Engine::key_up(const hi::Callback &cb, key::KeyCode key) noexcept {
     Engine *e = cb.get_user_data<Engine>();
     using key::KeyCode;
     switch (key) {
+    case KeyCode::F5: {
+        e->world.toggle_greedy_meshing();
+    } break;
+
+    case KeyCode::F6: {
+        e->world.cycle_stream_shape();
+    } break;
+
+    case KeyCode::F7: {
+        e->world.change_worker_count(-1);
+    } break;
+
+    case KeyCode::F8: {
+        e->world.change_worker_count(1);
+    } break;
+
+    case KeyCode::F9: {
+        e->world.cycle_worker_priority();
+    } break;
+
+    case KeyCode::F10: {
+        e->world.cycle_worker_affinity();
+    } break;
+
     case KeyCode::F4: {
         if (e->config.is_wireframe) {
             glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
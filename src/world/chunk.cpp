@@ -3,24 +3,177 @@
 #include <algorithm>
 #include <complex>
 
-constexpr unsigned MAX_HEIGHT_CHUNKS = 4;
-
 namespace hi::Chunk {
 void generate_chunk(unsigned cx, unsigned cy, unsigned cz, Block *out,
                     const NoiseSystem &noise, unsigned lod_size) noexcept {
     if (cy > MAX_HEIGHT_CHUNKS)
         return;
+    // the noise depends on the column only, evaluate it once per column
+    Heightmap heights;
+    generate_heightmap(int(cx), int(cz), heights, noise);
+    generate_chunk(cy, heights, out, lod_size);
+} // generate_chunk
+
+void generate_chunk(unsigned cy, const Heightmap &heights, Block *out,
+                    unsigned lod_size) noexcept {
+    if (cy > MAX_HEIGHT_CHUNKS)
+        return;
     for (unsigned z = 0; z < DEPTH; z += lod_size)
-        for (unsigned y = 0; y < HEIGHT; y += lod_size)
-            for (unsigned x = 0; x < WIDTH; x += lod_size) {
+        for (unsigned x = 0; x < WIDTH; x += lod_size) {
+            int height = heights.heights[z + 1][x + 1];
+            for (unsigned y = 0; y < HEIGHT; y += lod_size) {
                 unsigned idx = calculate_block_index(x, y, z);
-                int gx = int(cx * WIDTH + x);
                 int gy = int(cy * HEIGHT + y);
-                int gz = int(cz * DEPTH + z);
-                generate_block(gx, gy, gz, idx, out, noise);
+                out[idx] = column_block(gy, height);
             }
+        }
 } // generate_chunk
 
+void generate_heightmap(int cx, int cz, Heightmap &out,
+                        const NoiseSystem &noise) noexcept {
+    for (int z = -1; z <= int(DEPTH); ++z)
+        for (int x = -1; x <= int(WIDTH); ++x)
+            out.heights[z + 1][x + 1] = column_height(
+                cx * int(WIDTH) + x, cz * int(DEPTH) + z, noise);
+} // generate_heightmap
+
+void build_occupancy(const Block *blocks, Occupancy &opaque,
+                     Occupancy &liquid) noexcept {
+    constexpr uint16_t air_id = BlockList::Air.block_id();
+    constexpr uint16_t water_id = BlockList::Water.block_id();
+    for (unsigned z = 0; z < DEPTH; ++z)
+        for (unsigned y = 0; y < HEIGHT; ++y) {
+            const Block *row = &blocks[calculate_block_index(0, y, z)];
+            uint32_t opaque_bits = 0, liquid_bits = 0;
+            for (unsigned x = 0; x < WIDTH; ++x) {
+                const uint16_t id = row[x].block_id();
+                opaque_bits |= uint32_t(id != air_id && id != water_id) << x;
+                liquid_bits |= uint32_t(id == water_id) << x;
+            }
+            opaque.rows[z][y] = opaque_bits;
+            liquid.rows[z][y] = liquid_bits;
+        }
+} // build_occupancy
+
+void build_occupancy(int cy, const Heightmap &heights,
+                     Occupancy &opaque) noexcept {
+    const int base = cy * int(HEIGHT);
+    for (unsigned z = 0; z < DEPTH; ++z)
+        for (unsigned y = 0; y < HEIGHT; ++y) {
+            const int gy = base + int(y);
+            uint32_t bits = 0;
+            for (unsigned x = 0; x < WIDTH; ++x)
+                bits |= uint32_t(gy <= heights.top(x, z)) << x;
+            opaque.rows[z][y] = bits;
+        }
+} // build_occupancy
+
+void generate_voxels(int cy, Data &chunk) {
+    chunk.voxels = std::make_unique<Voxels>();
+    Voxels &voxels = *chunk.voxels;
+    generate_chunk(unsigned(cy), chunk.heights, voxels.blocks);
+    build_occupancy(voxels.blocks, voxels.opaque, voxels.liquid);
+} // generate_voxels
+
+bool set_block(Data &chunk, unsigned x, unsigned y, unsigned z,
+               Block block) noexcept {
+    Voxels &voxels = *chunk.voxels;
+    voxels.blocks[calculate_block_index(x, y, z)] = block;
+
+    const uint16_t id = block.block_id();
+    const bool liquid = id == BlockList::Water.block_id();
+    const bool opaque = !liquid && id != BlockList::Air.block_id();
+    const uint32_t bit = 1u << x;
+    uint32_t &opaque_row = voxels.opaque.rows[z][y];
+    uint32_t &liquid_row = voxels.liquid.rows[z][y];
+    const uint32_t old_opaque = opaque_row, old_liquid = liquid_row;
+    opaque_row = opaque ? (opaque_row | bit) : (opaque_row & ~bit);
+    liquid_row = liquid ? (liquid_row | bit) : (liquid_row & ~bit);
+    return opaque_row != old_opaque || liquid_row != old_liquid;
+} // set_block
+
+void extract_border_plane(const Occupancy &occupancy, int face,
+                          BorderPlane &out) noexcept {
+    switch (face) {
+    case 0: // z+
+    case 1: // z-
+        memcpy(out.rows, occupancy.rows[face == 0 ? DEPTH - 1 : 0],
+               sizeof(out.rows));
+        break;
+    case 2: // x-
+    case 3: // x+
+    {
+        const unsigned x = (face == 3) ? WIDTH - 1 : 0;
+        for (unsigned z = 0; z < DEPTH; ++z) {
+            uint32_t bits = 0;
+            for (unsigned y = 0; y < HEIGHT; ++y)
+                bits |= ((occupancy.rows[z][y] >> x) & 1u) << y;
+            out.rows[z] = bits;
+        }
+    } break;
+    case 4: // y+
+    case 5: // y-
+    default: {
+        const unsigned y = (face == 4) ? HEIGHT - 1 : 0;
+        for (unsigned z = 0; z < DEPTH; ++z)
+            out.rows[z] = occupancy.rows[z][y];
+    } break;
+    }
+} // extract_border_plane
+
+void extract_borders(int cy, const Data &chunk, Borders &out) noexcept {
+    if (!chunk.voxels && !is_world_row(cy)) {
+        memset(&out, 0, sizeof(out));
+        return;
+    }
+    if (!chunk.voxels) {
+        Occupancy opaque;
+        build_occupancy(cy, chunk.heights, opaque);
+        for (int face = 0; face < 6; ++face)
+            extract_border_plane(opaque, face, out.opaque[face]);
+        memset(out.liquid, 0, sizeof(out.liquid));
+        return;
+    }
+    for (int face = 0; face < 6; ++face) {
+        extract_border_plane(chunk.voxels->opaque, face, out.opaque[face]);
+        extract_border_plane(chunk.voxels->liquid, face, out.liquid[face]);
+    }
+} // extract_borders
+
+void predict_border_plane(int cy, const Heightmap &heights, int face,
+                          BorderPlane &opaque, BorderPlane &liquid) noexcept {
+    // rows outside of the world are never generated and stay air
+    const int row = cy + (face == 4) - (face == 5);
+    const bool in_world = row >= 0 && row <= int(MAX_HEIGHT_CHUNKS);
+    const int base = cy * int(HEIGHT);
+
+    for (int i = 0; i < 32; ++i) {
+        uint32_t opaque_bits = 0, liquid_bits = 0;
+        for (int j = 0; j < 32; ++j) {
+            int x, gy, z; // the neighbour's block, in this chunk's columns
+            switch (face) {
+            case 0: // z+: rows[y] bit x
+            case 1: // z-
+                x = j, gy = base + i, z = (face == 0) ? int(DEPTH) : -1;
+                break;
+            case 2: // x-: rows[z] bit y
+            case 3: // x+
+                x = (face == 3) ? int(WIDTH) : -1, gy = base + j, z = i;
+                break;
+            default: // y+, y-: rows[z] bit x
+                x = j, gy = (face == 4) ? base + int(HEIGHT) : base - 1, z = i;
+                break;
+            }
+            const bool water = in_world && gy <= SEA_LEVEL;
+            const bool ground = in_world && !water && gy <= heights.top(x, z);
+            opaque_bits |= uint32_t(ground) << j;
+            liquid_bits |= uint32_t(water) << j;
+        }
+        opaque.rows[i] = opaque_bits;
+        liquid.rows[i] = liquid_bits;
+    }
+} // predict_border_plane
+
 inline constexpr void apply_simple_light_to_block(Block &block, int middle,
                                                   int gy) {
     constexpr int threshold = 40; // gradient size
@@ -37,15 +190,7 @@ inline constexpr void apply_simple_light_to_block(Block &block, int middle,
     block.set_light(light);
 }
 
-void generate_block(int gx, int gy, int gz, unsigned idx, Block *out,
-                    const NoiseSystem &noise) noexcept {
-    constexpr int SEA_LEVEL = 40;
-    constexpr int BEACH_LEVEL = SEA_LEVEL + 1;
-    constexpr int MOUNTAIN_ICE_LEVEL = MAX_HEIGHT_CHUNKS * Chunk::HEIGHT - 4;
-    constexpr int TERRAIN_MIDDLE_LEVEL = MOUNTAIN_ICE_LEVEL - SEA_LEVEL;
-
-    constexpr int DIRT_DEPTH = 4;
-
+int column_height(int gx, int gz, const NoiseSystem &noise) noexcept {
     constexpr double scale = 0.004;
 
     // === Noise Manipulation ===
@@ -61,25 +206,42 @@ void generate_block(int gx, int gy, int gz, unsigned idx, Block *out,
         /* pers */ 0.3);
     double h = std::pow(h1 + h2 * 0.3, 2.0);
 
-    int H = int(h * MAX_HEIGHT_CHUNKS * Chunk::HEIGHT);
+    return int(h * MAX_HEIGHT_CHUNKS * Chunk::HEIGHT);
+} // column_height
+
+Block column_block(int gy, int height) noexcept {
+    constexpr int BEACH_LEVEL = SEA_LEVEL + 1;
+    constexpr int MOUNTAIN_ICE_LEVEL = MAX_HEIGHT_CHUNKS * Chunk::HEIGHT - 4;
+    constexpr int TERRAIN_MIDDLE_LEVEL = MOUNTAIN_ICE_LEVEL - SEA_LEVEL;
+
+    constexpr int DIRT_DEPTH = 4;
+
+    const int H = height;
 
     // === Placement Logic ===
     using namespace BlockList;
+    Block block;
     if (gy > H) {
-        out[idx] = (gy <= SEA_LEVEL) ? Water : Air;
+        block = (gy <= SEA_LEVEL) ? Water : Air;
     } else if (gy <= SEA_LEVEL) {
-        out[idx] = Water;
+        block = Water;
     } else if (gy == H && gy <= BEACH_LEVEL) {
-        out[idx] = Sand;
+        block = Sand;
     } else if (gy == H) {
-        out[idx] = (gy <= MOUNTAIN_ICE_LEVEL) ? Grass : Ice;
+        block = (gy <= MOUNTAIN_ICE_LEVEL) ? Grass : Ice;
     } else if (gy > H - DIRT_DEPTH) {
-        out[idx] = Dirt;
+        block = Dirt;
     } else {
-        out[idx] = Cobblestone;
+        block = Cobblestone;
     }
 
-    apply_simple_light_to_block(out[idx], TERRAIN_MIDDLE_LEVEL, gy);
+    apply_simple_light_to_block(block, TERRAIN_MIDDLE_LEVEL, gy);
+    return block;
+} // column_block
+
+void generate_block(int gx, int gy, int gz, unsigned idx, Block *out,
+                    const NoiseSystem &noise) noexcept {
+    out[idx] = column_block(gy, column_height(gx, gz, noise));
 }
 
 } // namespace hi::Chunk
@@ -5,6 +5,7 @@
 #include "block.hpp"
 
 #include <assert.h>
+#include <memory>
 #include <vector> // for std::hash
 
 namespace hi {
@@ -15,8 +16,13 @@ struct NoiseSystem {
 
 namespace hi::Chunk {
 struct Mesh {
-    unsigned vertex_offset;
-    unsigned vertex_count;
+    unsigned page;        // of `Terrain::arena`
+    unsigned face_offset; // within the page
+    unsigned face_count;
+    // opaque faces are stored grouped by direction, in `Block::CUBE_POS`
+    // order, the translucent liquid faces follow them
+    unsigned direction_counts[6];
+    unsigned liquid_count;
     float world_x, world_y, world_z;
 }; // struct Mesh
 struct Key {
@@ -40,28 +46,168 @@ constexpr unsigned DEPTH = 32;
 
 constexpr unsigned BLOCKS_PER_CHUNK = WIDTH * HEIGHT * DEPTH;
 
+constexpr unsigned MAX_HEIGHT_CHUNKS = 4; // chunks above it stay empty
+constexpr int WORLD_TOP = (MAX_HEIGHT_CHUNKS + 1) * HEIGHT - 1;
+constexpr int SEA_LEVEL = 40;
+
+static_assert(WIDTH == 32 && HEIGHT == 32 && DEPTH == 32,
+              "occupancy rows are packed into 32-bit words");
+
+// meshes are split into 32x8x32 sections along y, edits remesh only the
+// sections they touch
+constexpr unsigned SECTION_HEIGHT = 8;
+constexpr unsigned SECTIONS = HEIGHT / SECTION_HEIGHT;
+
+/* Occupancy, one bit per block.
+   A row holds 32 blocks along x (bit x) and rows are indexed [z][y].
+   Faces along x come from shifting a row, faces along y/z from AND-ing it
+   with the neighbouring row, so one orientation is enough for culling. */
+struct Occupancy {
+    uint32_t rows[DEPTH][HEIGHT];
+}; // struct Occupancy
+
+/* Occupancy of one border layer of a chunk, 32x32 bits.
+   x faces: rows[z] bit y | y faces: rows[z] bit x | z faces: rows[y] bit x */
+struct BorderPlane {
+    uint32_t rows[32];
+}; // struct BorderPlane
+
+/* Terrain heights of the chunk columns and of the columns around it:
+   heights[z + 1][x + 1], x and z from -1 to 32. */
+struct Heightmap {
+    int heights[DEPTH + 2][WIDTH + 2];
+
+    // highest ground block of a column, clamped to the world
+    int top(int x, int z) const noexcept {
+        const int h = heights[z + 1][x + 1];
+        return h < WORLD_TOP ? h : WORLD_TOP;
+    }
+}; // struct Heightmap
+
+/* Everything the neighbours of a chunk need for culling: its border
+   layers, one per `Block::CUBE_POS` face, 128 bytes each. Kept apart from
+   `Data`, so meshing never reads the blocks of another chunk. */
+struct Borders {
+    BorderPlane opaque[6];
+    BorderPlane liquid[6];
+}; // struct Borders
+
+// the blocks of a chunk and their occupancy, 136 KiB
+struct Voxels {
+    Block blocks[BLOCKS_PER_CHUNK];
+    Occupancy opaque; // neither air nor liquid
+    Occupancy liquid;
+}; // struct Voxels
+
+/* Shared with the workers and never changed once published: edits work on
+   a copy with the next `version`. Chunks meshed from their `Heightmap`
+   keep no voxels until their first edit, chunks outside of the world rows
+   no heights either. */
+struct Data {
+    std::unique_ptr<Voxels> voxels; // null for heightfield chunks
+    Heightmap heights;              // what the chunk was generated from
+    unsigned version = 0;
+
+    Data() noexcept = default;
+    // a deep copy, for edits
+    Data(const Data &other)
+        : voxels(other.voxels ? std::make_unique<Voxels>(*other.voxels)
+                              : nullptr),
+          heights(other.heights), version(other.version) {}
+    Data &operator=(const Data &) = delete;
+
+    bool has_blocks() const noexcept { return voxels != nullptr; }
+}; // struct Data
+
 inline unsigned calculate_block_index(unsigned x, unsigned y,
                                       unsigned z) noexcept {
     assert(x < WIDTH && y < HEIGHT && z < DEPTH);
     return x + y * WIDTH + z * WIDTH * HEIGHT;
 } // calculate_block_index
 
+// `face` uses the `Block::CUBE_POS` order: z+, z-, x-, x+, y+, y-
+inline Key neighbor_key(const Key &key, int face) noexcept {
+    Key nk = key;
+    switch (face) {
+    case 0:
+        ++nk.z;
+        break;
+    case 1:
+        --nk.z;
+        break;
+    case 2:
+        --nk.x;
+        break;
+    case 3:
+        ++nk.x;
+        break;
+    case 4:
+        ++nk.y;
+        break;
+    case 5:
+        --nk.y;
+        break;
+    }
+    return nk;
+} // neighbor_key
+
 void generate_chunk(unsigned cx, unsigned cy, unsigned cz, Block *out,
                     const NoiseSystem &noise, unsigned lod_size = 1) noexcept;
+void generate_chunk(unsigned cy, const Heightmap &heights, Block *out,
+                    unsigned lod_size = 1) noexcept;
+
+void generate_heightmap(int cx, int cz, Heightmap &out,
+                        const NoiseSystem &noise) noexcept;
+
+void build_occupancy(const Block *blocks, Occupancy &opaque,
+                     Occupancy &liquid) noexcept;
+void build_occupancy(int cy, const Heightmap &heights,
+                     Occupancy &opaque) noexcept;
+// the voxels of chunk row `cy` from the heights of `chunk`
+void generate_voxels(int cy, Data &chunk);
+
+/* Writes a block and its occupancy, returns whether the occupancy changed.
+   The chunk has voxels. */
+bool set_block(Data &chunk, unsigned x, unsigned y, unsigned z,
+               Block block) noexcept;
+
+void extract_border_plane(const Occupancy &occupancy, int face,
+                          BorderPlane &out) noexcept;
+// of chunk row `cy`, heightfield chunks are all ground or air and those
+// outside of the world all air
+void extract_borders(int cy, const Data &chunk, Borders &out) noexcept;
+// border layer the generator will give the neighbour on side `face`
+void predict_border_plane(int cy, const Heightmap &heights, int face,
+                          BorderPlane &opaque, BorderPlane &liquid) noexcept;
 
 void generate_block(int gx, int gy, int gz, unsigned idx, Block *out,
                     const NoiseSystem &noise) noexcept;
 
+// ground is (SEA_LEVEL, height] of a column, water fills the rest up to
+// the sea level
+int column_height(int gx, int gz, const NoiseSystem &noise) noexcept;
+Block column_block(int gy, int height) noexcept;
+
+// rows below and above it are never generated and stay air
+inline bool is_world_row(int cy) noexcept {
+    return cy >= 0 && cy <= int(MAX_HEIGHT_CHUNKS);
+} // is_world_row
+
+/* Every column of the chunk row `cy` is air above a single run of ground
+   which continues below the chunk, without any water. Such chunks are
+   meshed straight from their `Heightmap`. */
+inline bool is_heightfield(int cy) noexcept {
+    return is_world_row(cy) && cy * int(HEIGHT) > SEA_LEVEL + 1;
+} // is_heightfield
+
 inline bool is_block_on_chunk_edge(int x, int y, int z) noexcept {
     return x == 0 || x == Chunk::WIDTH - 1 || y == 0 ||
            y == Chunk::HEIGHT - 1 || z == 0 || z == Chunk::DEPTH - 1;
 } // is_block_on_chunk_edge
 
-inline bool is_chunk_visible(const Mesh &mesh,
+// the chunk box with its lowest corner at (x0, y0, z0) in world space
+inline bool is_chunk_visible(float x0, float y0, float z0,
                              const float frustum_planes[6][4]) noexcept {
-    const float x0 = mesh.world_x;
-    const float y0 = mesh.world_y;
-    const float z0 = mesh.world_z;
     const float x1 = x0 + Chunk::WIDTH;
     const float y1 = y0 + Chunk::HEIGHT;
     const float z1 = z0 + Chunk::DEPTH;
@@ -77,6 +223,33 @@ inline bool is_chunk_visible(const Mesh &mesh,
     return true;
 } // is_chunk_visible
 
+inline bool is_chunk_visible(const Mesh &mesh,
+                             const float frustum_planes[6][4]) noexcept {
+    return is_chunk_visible(mesh.world_x, mesh.world_y, mesh.world_z,
+                            frustum_planes);
+} // is_chunk_visible
+
+inline bool is_chunk_visible(const Key &key,
+                             const float frustum_planes[6][4]) noexcept {
+    return is_chunk_visible(float(key.x * int(WIDTH)),
+                            float(key.y * int(HEIGHT)),
+                            float(key.z * int(DEPTH)), frustum_planes);
+} // is_chunk_visible
+
+// directions whose faces may point at the camera, bit per `CUBE_POS` face
+inline unsigned facing_directions(const Mesh &mesh,
+                                  const float camera_pos[3]) noexcept {
+    // a face is seen from its front only: +z faces lie at z > world_z etc.
+    unsigned mask = 0;
+    mask |= unsigned(camera_pos[2] > mesh.world_z) << 0;
+    mask |= unsigned(camera_pos[2] < mesh.world_z + Chunk::DEPTH) << 1;
+    mask |= unsigned(camera_pos[0] < mesh.world_x + Chunk::WIDTH) << 2;
+    mask |= unsigned(camera_pos[0] > mesh.world_x) << 3;
+    mask |= unsigned(camera_pos[1] > mesh.world_y) << 4;
+    mask |= unsigned(camera_pos[1] < mesh.world_y + Chunk::HEIGHT) << 5;
+    return mask;
+} // facing_directions
+
 inline void extract_frustum_planes(float planes[6][4],
                                    const math::mat4x4 view) noexcept {
     const float *m = &view[0][0];
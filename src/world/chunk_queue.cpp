@@ -0,0 +1,159 @@
+#include "chunk_queue.hpp"
+
+#include "../external/linmath.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+namespace hi {
+
+ChunkQueue::ChunkQueue(int radius, StreamShape shape) noexcept
+    : radius{radius}, shape{shape}, view{}, buckets(2 * (radius + 1)),
+      lowest{unsigned(buckets.size())} {}
+
+bool ChunkQueue::push(const Chunk::Key &key) {
+    if (queued.contains(key) || deferred.contains(key))
+        return false;
+    const int s = score(key);
+    if (s == DEFERRED)
+        deferred.insert(key);
+    if (s < 0)
+        return false;
+    queued.insert(key);
+    buckets[s].push_back(key);
+    lowest = std::min(lowest, unsigned(s));
+    return true;
+}
+
+bool ChunkQueue::pop(Chunk::Key &out) {
+    if (view_changed)
+        rescore();
+    while (lowest < buckets.size()) {
+        auto &bucket = buckets[lowest];
+        if (bucket.empty()) {
+            ++lowest;
+            continue;
+        }
+        out = bucket.back();
+        bucket.pop_back();
+        if (queued.erase(out))
+            return true; // otherwise an erased chunk's entry
+    }
+    return false;
+}
+
+size_t ChunkQueue::set_view(const View &next) {
+    if (!memcmp(&view, &next, sizeof(view)))
+        return 0;
+    view = next;
+    view_changed = true;
+
+    // placed into the buckets by the rescore of the next `pop`
+    size_t queued_again = 0;
+    for (auto it = deferred.begin(); it != deferred.end();) {
+        const int s = score(*it);
+        if (s == DEFERRED) {
+            ++it;
+            continue;
+        }
+        if (s >= 0) {
+            queued.insert(*it);
+            ++queued_again;
+        }
+        it = deferred.erase(it);
+    }
+    return queued_again;
+}
+
+size_t ChunkQueue::set_center(const Chunk::Key &center) {
+    if (center == view.center)
+        return 0;
+    view.center = center;
+    deferred.clear();
+    const size_t before = queued.size();
+    rescore();
+    return before - queued.size();
+}
+
+void ChunkQueue::set_shape(StreamShape next) noexcept {
+    if (next == shape)
+        return;
+    shape = next;
+    view_changed = true;
+}
+
+void ChunkQueue::move_center(const Chunk::Key &center) noexcept {
+    if (center == view.center)
+        return;
+    view.center = center;
+    view_changed = true;
+}
+
+int ChunkQueue::score(const Chunk::Key &key) const noexcept {
+    const int dist = stream_distance(shape, key.x - view.center.x,
+                                     key.y - view.center.y,
+                                     key.z - view.center.z);
+    const int dist_ahead =
+        stream_distance(shape, key.x - view.ahead.x, key.y - view.ahead.y,
+                        key.z - view.ahead.z);
+    if (dist > radius && dist_ahead > radius)
+        return OUT_OF_RANGE;
+    const int near = std::min({dist, dist_ahead, path_distance(key)});
+    if (Chunk::is_chunk_visible(key, view.frustum_planes))
+        return near;
+
+    // everything out of view waits for the whole frustum, and far behind
+    // the camera until the view comes back to it
+    const float behind = float(key.x - view.center.x) * view.forward[0] +
+                         float(key.y - view.center.y) * view.forward[1] +
+                         float(key.z - view.center.z) * view.forward[2];
+    if (behind < 0.f && dist > view.behind_radius)
+        return DEFERRED;
+    return near + radius + 1;
+}
+
+int ChunkQueue::path_distance(const Chunk::Key &key) const noexcept {
+    const float path[3] = {float(view.ahead.x - view.center.x),
+                           float(view.ahead.y - view.center.y),
+                           float(view.ahead.z - view.center.z)};
+    const float length_sq =
+        path[0] * path[0] + path[1] * path[1] + path[2] * path[2];
+    if (length_sq == 0.f)
+        return radius + 1;
+
+    const float to_key[3] = {float(key.x - view.center.x),
+                             float(key.y - view.center.y),
+                             float(key.z - view.center.z)};
+    const float t = std::clamp((to_key[0] * path[0] + to_key[1] * path[1] +
+                                to_key[2] * path[2]) /
+                                   length_sq,
+                               0.f, 1.f);
+    int offset[3]; // to the nearest chunk on the path
+    for (int i = 0; i < 3; ++i)
+        offset[i] = int(math::floorf(to_key[i] - t * path[i] + 0.5f));
+    return stream_distance(shape, offset[0], offset[1], offset[2]);
+}
+
+void ChunkQueue::rescore() {
+    view_changed = false;
+    lowest = unsigned(buckets.size());
+
+    // from `queued`, which drops the entries of erased chunks as well
+    for (auto &bucket : buckets)
+        bucket.clear();
+    for (auto it = queued.begin(); it != queued.end();) {
+        const int s = score(*it);
+        if (s == DEFERRED)
+            deferred.insert(*it);
+        if (s < 0) {
+            it = queued.erase(it); // left behind, requested again if needed
+            continue;
+        }
+        buckets[s].push_back(*it);
+        lowest = std::min(lowest, unsigned(s));
+        ++it;
+    }
+}
+
+} // namespace hi
@@ -0,0 +1,78 @@
+#pragma once
+
+#include "chunk.hpp"
+#include "stream_volume.hpp"
+
+#include <unordered_set>
+#include <vector>
+
+namespace hi {
+
+/* Chunks waiting to be built, ordered by the view at the time they are
+   taken: chunks inside the view frustum first, then the rest; each nearest
+   first, where the distance is the lesser of the one to the center and the
+   one to the path towards `ahead`. Scores are small integers, so a bucket
+   per score stands in for a binary heap; whenever the view changed since
+   the last `pop`, every queued chunk is scored again. Erased chunks leave
+   their bucket entries behind, `pop` skips them.
+   Chunks out of view behind the camera past `behind_radius` are deferred
+   instead of queued, so less is loaded behind a moving camera; `set_view`
+   queues them again once the view brings them within it.
+   Not synchronized, `Terrain` guards it with `mutex_pending`. */
+struct ChunkQueue {
+    struct View {
+        Chunk::Key center;
+        Chunk::Key ahead; // where the camera is heading, `center` if still
+        int behind_radius;
+        float forward[3];
+        float frustum_planes[6][4];
+    }; // struct View
+
+    // chunks farther than `radius` from both the view center and `ahead`
+    // are dropped, distances are measured in `shape`
+    ChunkQueue(int radius, StreamShape shape) noexcept;
+
+    // false if the chunk is queued or deferred already, or out of range
+    bool push(const Chunk::Key &key);
+    // takes the best chunk, false if none is left
+    bool pop(Chunk::Key &out);
+    // false if the chunk is not queued
+    bool erase(const Chunk::Key &key) { return queued.erase(key) != 0; }
+    bool contains(const Chunk::Key &key) const noexcept {
+        return queued.contains(key);
+    }
+    size_t size() const noexcept { return queued.size(); }
+
+    // returns the count of deferred chunks queued again
+    size_t set_view(const View &view);
+    /* Moves the view center at once, returns the count of chunks dropped.
+       Deferred chunks are dropped as well, the caller streams anew. */
+    size_t set_center(const Chunk::Key &center);
+    // rescored by the next `pop`
+    void set_shape(StreamShape shape) noexcept;
+    /* Moves the view center without rescoring, the next `pop` does; for
+       small moves where the caller has erased the chunks left behind. */
+    void move_center(const Chunk::Key &center) noexcept;
+
+  private:
+    int radius;
+    StreamShape shape;
+    View view;
+    bool view_changed = false;
+
+    std::vector<std::vector<Chunk::Key>> buckets; // by `score`
+    unsigned lowest = 0; // no chunks in the buckets below it
+    std::unordered_set<Chunk::Key, Chunk::Key::Hash> queued;
+    std::unordered_set<Chunk::Key, Chunk::Key::Hash> deferred;
+
+    static constexpr int OUT_OF_RANGE = -1;
+    static constexpr int DEFERRED = -2;
+
+    // less is better, negative when not to be queued
+    int score(const Chunk::Key &key) const noexcept;
+    // from the chunk to the nearest chunk on the way to `view.ahead`
+    int path_distance(const Chunk::Key &key) const noexcept;
+    void rescore();
+}; // struct ChunkQueue
+
+} // namespace hi
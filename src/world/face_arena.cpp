@@ -0,0 +1,309 @@
+#include "face_arena.hpp"
+
+#include <algorithm>
+#include <bit>
+
+namespace hi {
+
+void FaceArena::init(unsigned max_faces) noexcept {
+    GLint max_texels = 0;
+    glGetIntegerv(GL_MAX_TEXTURE_BUFFER_SIZE, &max_texels);
+    page_faces = std::min(unsigned(PAGE_BYTES / FACE_BYTES),
+                          unsigned(std::max(max_texels, 1)));
+    max_pages = std::max(max_faces / page_faces, 1u);
+    for (auto &level : heads)
+        std::fill(std::begin(level), std::end(level), NONE);
+}
+
+bool FaceArena::allocate(unsigned count, Slot &out) {
+    if (!count) {
+        out = {0, 0}; // never drawn nor written, takes no page
+        return true;
+    }
+    if (count > page_faces)
+        return false;
+
+    uint32_t index = find_free(count);
+    if (index == NONE && (index = add_page()) == NONE)
+        return false;
+    out = take(index, count);
+    return true;
+}
+
+void FaceArena::free(const Slot &slot, unsigned count) {
+    if (!count || slot.page >= pages.size() || !pages[slot.page])
+        return;
+    Page &page = *pages[slot.page];
+    auto used = page.used.find(slot.offset);
+    if (used == page.used.end())
+        return;
+    uint32_t index = used->second;
+    page.used.erase(used);
+    page.used_faces -= blocks[index].size;
+    blocks[index].free = true;
+
+    // merges with the free ranges on both sides
+    if (const uint32_t prev = blocks[index].prev_phys;
+        prev != NONE && blocks[prev].free) {
+        remove_free(prev);
+        blocks[prev].size += blocks[index].size;
+        blocks[prev].next_phys = blocks[index].next_phys;
+        if (blocks[prev].next_phys != NONE)
+            blocks[blocks[prev].next_phys].prev_phys = prev;
+        spare_blocks.push_back(index);
+        index = prev;
+    }
+    if (const uint32_t next = blocks[index].next_phys;
+        next != NONE && blocks[next].free) {
+        remove_free(next);
+        blocks[index].size += blocks[next].size;
+        blocks[index].next_phys = blocks[next].next_phys;
+        if (blocks[index].next_phys != NONE)
+            blocks[blocks[index].next_phys].prev_phys = index;
+        spare_blocks.push_back(next);
+    }
+
+    if (blocks[index].size < page_faces) {
+        insert_free(index);
+        return;
+    }
+
+    // empty, its memory goes back to the driver
+    spare_blocks.push_back(index);
+    pages[slot.page].reset();
+    --live_pages;
+    if (slot.page == evacuated)
+        evacuated = NONE;
+    while (!pages.empty() && !pages.back())
+        pages.pop_back();
+}
+
+void FaceArena::write(const Slot &slot, unsigned first, unsigned count,
+                      const void *faces) const noexcept {
+    const Page &page = *pages[slot.page];
+    page.vbo.bind(GL_TEXTURE_BUFFER);
+    page.vbo.sub_data(/* target */ GL_TEXTURE_BUFFER,
+                      /* offset */ GLintptr(slot.offset + first) * FACE_BYTES,
+                      /* size   */ count * FACE_BYTES,
+                      /* data   */ faces);
+}
+
+void FaceArena::bind(unsigned page) const noexcept {
+    pages[page]->texture.bind(GL_TEXTURE_BUFFER);
+}
+
+unsigned FaceArena::compaction_page() noexcept {
+    if (evacuated != NONE)
+        return evacuated;
+    if (retry_wait) {
+        --retry_wait;
+        return NONE;
+    }
+    const size_t reserved = size_t(live_pages) * page_faces;
+    if (live_pages < 2 || free_faces < COMPACT_FREE_SHARE * reserved)
+        return NONE;
+
+    // the emptiest page, if the free ranges of the others can take it
+    unsigned emptiest = NONE;
+    for (unsigned i = 0; i < pages.size(); ++i)
+        if (pages[i] && (emptiest == NONE || pages[i]->used_faces <=
+                                                 pages[emptiest]->used_faces))
+            emptiest = i;
+    const unsigned used = pages[emptiest]->used_faces;
+    if (free_faces - (page_faces - used) < used)
+        return NONE;
+
+    for (uint32_t i = first_block(emptiest); i != NONE;
+         i = blocks[i].next_phys)
+        if (blocks[i].free)
+            remove_free(i);
+    evacuated = emptiest;
+    return evacuated;
+}
+
+bool FaceArena::move(Slot &slot, unsigned count) {
+    const uint32_t index = find_free(count);
+    if (index == NONE) {
+        stop_evacuation();
+        retry_wait = COMPACT_RETRY_CALLS;
+        return false;
+    }
+    const Slot to = take(index, count);
+
+    // queued after the draws that read the old range, before the ones
+    // that read the new one
+    pages[slot.page]->vbo.bind(GL_COPY_READ_BUFFER);
+    pages[to.page]->vbo.bind(GL_COPY_WRITE_BUFFER);
+    glCopyBufferSubData(/* read_target  */ GL_COPY_READ_BUFFER,
+                        /* write_target */ GL_COPY_WRITE_BUFFER,
+                        /* read_offset  */ GLintptr(slot.offset) * FACE_BYTES,
+                        /* write_offset */ GLintptr(to.offset) * FACE_BYTES,
+                        /* size         */ GLsizeiptr(count) * FACE_BYTES);
+    free(slot, count);
+    slot = to;
+    return true;
+}
+
+FaceArena::Stats FaceArena::stats() const noexcept {
+    Stats stats{free_faces, 0, free_blocks};
+    if (!first_bitmap)
+        return stats;
+    // the largest class that is not empty holds the largest range
+    const unsigned first = std::bit_width(first_bitmap) - 1;
+    const unsigned second = std::bit_width(second_bitmap[first]) - 1;
+    for (uint32_t i = heads[first][second]; i != NONE; i = blocks[i].next_free)
+        stats.largest_free = std::max<size_t>(stats.largest_free,
+                                              blocks[i].size);
+    return stats;
+}
+
+void FaceArena::size_class(unsigned size, unsigned &first,
+                           unsigned &second) noexcept {
+    if (size < SECOND_LEVELS) {
+        first = 0;
+        second = size;
+        return;
+    }
+    const unsigned log = std::bit_width(size) - 1;
+    first = log - SECOND_LEVEL_BITS + 1;
+    second = (size >> (log - SECOND_LEVEL_BITS)) ^ SECOND_LEVELS;
+}
+
+uint32_t FaceArena::new_block(const Block &block) {
+    if (spare_blocks.empty()) {
+        blocks.push_back(block);
+        return uint32_t(blocks.size() - 1);
+    }
+    const uint32_t index = spare_blocks.back();
+    spare_blocks.pop_back();
+    blocks[index] = block;
+    return index;
+}
+
+void FaceArena::insert_free(uint32_t index) noexcept {
+    Block &block = blocks[index];
+    if (block.page == evacuated)
+        return;
+    unsigned first, second;
+    size_class(block.size, first, second);
+    block.prev_free = NONE;
+    block.next_free = heads[first][second];
+    if (block.next_free != NONE)
+        blocks[block.next_free].prev_free = index;
+    heads[first][second] = index;
+    first_bitmap |= 1u << first;
+    second_bitmap[first] |= 1u << second;
+    free_faces += block.size;
+    ++free_blocks;
+}
+
+void FaceArena::remove_free(uint32_t index) noexcept {
+    const Block &block = blocks[index];
+    if (block.page == evacuated)
+        return;
+    unsigned first, second;
+    size_class(block.size, first, second);
+    if (block.prev_free != NONE)
+        blocks[block.prev_free].next_free = block.next_free;
+    else
+        heads[first][second] = block.next_free;
+    if (block.next_free != NONE)
+        blocks[block.next_free].prev_free = block.prev_free;
+
+    if (heads[first][second] == NONE) {
+        second_bitmap[first] &= ~(1u << second);
+        if (!second_bitmap[first])
+            first_bitmap &= ~(1u << first);
+    }
+    free_faces -= block.size;
+    --free_blocks;
+}
+
+uint32_t FaceArena::find_free(unsigned size) const noexcept {
+    // rounded up to the next class, whose ranges all fit
+    if (size >= SECOND_LEVELS)
+        size += (1u << (std::bit_width(size) - 1 - SECOND_LEVEL_BITS)) - 1;
+    unsigned first, second;
+    size_class(size, first, second);
+    if (first >= FIRST_LEVELS)
+        return NONE;
+
+    uint32_t seconds = second_bitmap[first] & (~0u << second);
+    if (!seconds) {
+        const uint32_t firsts =
+            first + 1 < 32 ? first_bitmap & (~0u << (first + 1)) : 0;
+        if (!firsts)
+            return NONE;
+        first = std::countr_zero(firsts);
+        seconds = second_bitmap[first];
+    }
+    return heads[first][std::countr_zero(seconds)];
+}
+
+FaceArena::Slot FaceArena::take(uint32_t index, unsigned count) {
+    remove_free(index);
+
+    // the rest of the range stays free
+    if (blocks[index].size > count) {
+        const Block &block = blocks[index];
+        const uint32_t rest =
+            new_block({block.page, block.offset + count, block.size - count,
+                       index, block.next_phys, NONE, NONE, true});
+        if (blocks[rest].next_phys != NONE)
+            blocks[blocks[rest].next_phys].prev_phys = rest;
+        blocks[index].next_phys = rest;
+        blocks[index].size = count;
+        insert_free(rest);
+    }
+
+    Block &block = blocks[index];
+    block.free = false;
+    Page &page = *pages[block.page];
+    page.used.emplace(block.offset, index);
+    page.used_faces += count;
+    return {block.page, block.offset};
+}
+
+void FaceArena::stop_evacuation() noexcept {
+    const unsigned page = evacuated;
+    evacuated = NONE;
+    for (uint32_t i = first_block(page); i != NONE; i = blocks[i].next_phys)
+        if (blocks[i].free)
+            insert_free(i);
+}
+
+uint32_t FaceArena::first_block(unsigned page) const noexcept {
+    // a live page hands out one block at least, the others precede it
+    uint32_t index = pages[page]->used.begin()->second;
+    while (blocks[index].prev_phys != NONE)
+        index = blocks[index].prev_phys;
+    return index;
+}
+
+uint32_t FaceArena::add_page() {
+    if (live_pages >= max_pages)
+        return NONE;
+    auto released = std::find(pages.begin(), pages.end(), nullptr);
+    if (released == pages.end())
+        released = pages.insert(pages.end(), nullptr);
+    *released = create_page();
+    ++live_pages;
+
+    const uint32_t index =
+        new_block({unsigned(released - pages.begin()), 0, page_faces, NONE,
+                   NONE, NONE, NONE, true});
+    insert_free(index);
+    return index;
+}
+
+std::unique_ptr<FaceArena::Page> FaceArena::create_page() const noexcept {
+    auto page = std::make_unique<Page>();
+    page->vbo.bind(GL_TEXTURE_BUFFER);
+    page->vbo.buffer_data(GL_TEXTURE_BUFFER, page_faces * FACE_BYTES, nullptr,
+                          GL_STATIC_DRAW);
+    page->texture.bind(GL_TEXTURE_BUFFER);
+    glTexBuffer(GL_TEXTURE_BUFFER, GL_RG32UI, page->vbo.get());
+    return page;
+}
+
+} // namespace hi
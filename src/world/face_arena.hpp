@@ -0,0 +1,143 @@
+#pragma once
+
+#include "../engine/opengl.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+namespace hi {
+
+/* GPU storage of the face records, in pages of PAGE_BYTES that are
+   allocated as they are needed and released once empty. Every page is a
+   buffer of its own, read through its own buffer texture, so the chunks
+   of one page are drawn together.
+   Slots come from a TLSF allocator over all pages: free ranges sit in
+   lists by size class, FIRST_LEVELS powers of two split into SECOND_LEVELS
+   each, with a bitmap per level, so that taking and returning a slot is
+   O(1). A freed range merges with the free ranges around it in its page,
+   and a page that is one free range again is released. The bookkeeping
+   lives on the CPU, the buffers only hold faces.
+   Churn still leaves pages that are mostly free, so the emptiest page is
+   evacuated once enough of the pages is free: its free ranges leave the
+   lists so that nothing new lands there, its slots are copied to the other
+   pages with `move` a few at a time, and it is released when the last one
+   is gone. */
+struct FaceArena {
+    static constexpr unsigned FACE_BYTES = 8; // `sizeof(FaceRecord)`
+    static constexpr size_t PAGE_BYTES = size_t(32) << 20;
+    // share of the faces of all pages that are free before a page is
+    // evacuated
+    static constexpr float COMPACT_FREE_SHARE = 0.5f;
+    // calls of `compaction_page` before an evacuation that ran out of room
+    // is tried again
+    static constexpr unsigned COMPACT_RETRY_CALLS = 600;
+
+    struct Slot {
+        unsigned page;
+        unsigned offset; // in faces, from the start of the page
+    }; // struct Slot
+
+    // for the debug overlay, in faces
+    struct Stats {
+        size_t free;
+        size_t largest_free; // a slot up to it fits without a new page
+        size_t free_ranges;
+    }; // struct Stats
+
+    FaceArena() noexcept = default;
+
+    FaceArena(const FaceArena &) = delete;
+    FaceArena &operator=(const FaceArena &) = delete;
+
+    /* Pages hold as many faces as a buffer texture can address, up to
+       PAGE_BYTES; `max_faces` limits all pages together. */
+    void init(unsigned max_faces) noexcept;
+
+    // false when no page has room and no page can be added
+    bool allocate(unsigned count, Slot &out);
+    // `count` as allocated
+    void free(const Slot &slot, unsigned count);
+    // `count` faces at `first` faces into the slot
+    void write(const Slot &slot, unsigned first, unsigned count,
+               const void *faces) const noexcept;
+    // the buffer texture of the page, to the active texture unit
+    void bind(unsigned page) const noexcept;
+    /* The page whose slots to `move`, starting an evacuation when the
+       pages are free enough, and NONE while none is needed. */
+    unsigned compaction_page() noexcept;
+    /* Copies the faces of a slot on the evacuated page to a free range of
+       another page, frees the slot and points it to the copy. False, and
+       the evacuation stops, when no free range fits. */
+    bool move(Slot &slot, unsigned count);
+
+    unsigned faces_per_page() const noexcept { return page_faces; }
+    unsigned page_count() const noexcept { return live_pages; }
+    size_t reserved_bytes() const noexcept {
+        return size_t(live_pages) * page_faces * FACE_BYTES;
+    }
+    Stats stats() const noexcept;
+
+    static constexpr uint32_t NONE = UINT32_MAX;
+
+  private:
+    static constexpr unsigned SECOND_LEVEL_BITS = 4;
+    static constexpr unsigned SECOND_LEVELS = 1u << SECOND_LEVEL_BITS;
+    // up to 2^22 faces, PAGE_BYTES of them
+    static constexpr unsigned FIRST_LEVELS = 20;
+
+    // a range of a page, free or handed out
+    struct Block {
+        unsigned page;
+        unsigned offset;
+        unsigned size;
+        uint32_t prev_phys, next_phys; // the ranges around it in the page
+        uint32_t prev_free, next_free; // in its size class, while free
+        bool free;
+    }; // struct Block
+
+    struct Page {
+        gl::VBO vbo;
+        gl::Texture texture;
+        // the blocks handed out, by offset
+        std::unordered_map<unsigned, uint32_t> used;
+        unsigned used_faces = 0;
+    }; // struct Page
+
+    // null where a page was released, so that slots keep their page index
+    std::vector<std::unique_ptr<Page>> pages;
+    unsigned page_faces = 0;
+    unsigned max_pages = 0;
+    unsigned live_pages = 0;
+
+    std::vector<Block> blocks;
+    std::vector<uint32_t> spare_blocks; // indices of unused `blocks`
+    uint32_t first_bitmap = 0;
+    uint32_t second_bitmap[FIRST_LEVELS] = {};
+    uint32_t heads[FIRST_LEVELS][SECOND_LEVELS];
+    size_t free_faces = 0;
+    size_t free_blocks = 0;
+    // its free ranges are out of the lists until it is released
+    uint32_t evacuated = NONE;
+    unsigned retry_wait = 0;
+
+    static void size_class(unsigned size, unsigned &first,
+                           unsigned &second) noexcept;
+    uint32_t new_block(const Block &block);
+    void insert_free(uint32_t index) noexcept;
+    void remove_free(uint32_t index) noexcept;
+    // a free block of at least `size` faces, NONE if there is none
+    uint32_t find_free(unsigned size) const noexcept;
+    // hands out `count` faces of a free block
+    Slot take(uint32_t index, unsigned count);
+    // puts the free ranges of the evacuated page back into the lists
+    void stop_evacuation() noexcept;
+    uint32_t first_block(unsigned page) const noexcept;
+    // a new page as one free block, NONE past `max_pages`
+    uint32_t add_page();
+    std::unique_ptr<Page> create_page() const noexcept;
+}; // struct FaceArena
+
+} // namespace hi
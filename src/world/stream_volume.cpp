@@ -0,0 +1,71 @@
+#include "stream_volume.hpp"
+
+#include "../external/linmath.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+
+namespace hi {
+
+// far enough out of any radius
+static constexpr int OUT_OF_RANGE = 1 << 20;
+
+// the length rounded to the nearest whole chunk: the least `d` with
+// `squared <= d * d + d`, exact whatever `math::sqrtf` is built with
+static int rounded_length(int squared) noexcept {
+    int d = int(math::sqrtf(float(squared)));
+    while (d * d + d < squared)
+        ++d;
+    while (d > 0 && (d - 1) * (d - 1) + (d - 1) >= squared)
+        --d;
+    return d;
+}
+
+int stream_distance(StreamShape shape, int dx, int dy, int dz) noexcept {
+    switch (shape) {
+    case StreamShape::Octahedron:
+        return std::abs(dx) + std::abs(dy) + std::abs(dz);
+    case StreamShape::Sphere:
+        return rounded_length(dx * dx + dy * dy + dz * dz);
+    case StreamShape::Cylinder:
+        if (std::abs(dy) > int(Chunk::MAX_HEIGHT_CHUNKS))
+            return OUT_OF_RANGE;
+        return rounded_length(dx * dx + dz * dz);
+    }
+    return OUT_OF_RANGE;
+}
+
+StreamVolume::StreamVolume(StreamShape shape, int radius)
+    : shape{shape}, radius{radius} {
+    auto distance = [&](const Chunk::Key &o) {
+        return stream_distance(shape, o.x, o.y, o.z);
+    };
+    auto squared = [](const Chunk::Key &o) {
+        return o.x * o.x + o.y * o.y + o.z * o.z;
+    };
+
+    const int R = radius;
+    for (int z = -R; z <= R; ++z)
+        for (int y = -R; y <= R; ++y)
+            for (int x = -R; x <= R; ++x)
+                if (distance({x, y, z}) <= R)
+                    offsets.push_back({x, y, z});
+    std::stable_sort(offsets.begin(), offsets.end(),
+                     [&](const Chunk::Key &a, const Chunk::Key &b) {
+                         const int da = distance(a), db = distance(b);
+                         return da != db ? da < db : squared(a) < squared(b);
+                     });
+
+    for (const Chunk::Key &o : offsets)
+        for (int negative = 0; negative < 2; ++negative) {
+            const int step = negative ? -1 : 1;
+            if (distance({o.x + step, o.y, o.z}) > R)
+                boundary[0][negative].push_back(o);
+            if (distance({o.x, o.y + step, o.z}) > R)
+                boundary[1][negative].push_back(o);
+            if (distance({o.x, o.y, o.z + step}) > R)
+                boundary[2][negative].push_back(o);
+        }
+}
+
+} // namespace hi
@@ -0,0 +1,63 @@
+#pragma once
+
+#include "chunk.hpp"
+
+#include <vector>
+
+namespace hi {
+
+enum class StreamShape : uint8_t {
+    Octahedron, // by manhattan distance
+    Sphere,
+    Cylinder, // vertical, and only the rows of the world
+};
+
+/* Whole chunk distance of an offset in the given shape, an offset is within
+   radius `r` when it is at most `r`. Spheres and cylinders round the
+   euclidean distance. A cylinder is as high as the world up and down,
+   which covers its rows from a center on any of them (see
+   `clamp_stream_center`), so only the horizontal distance counts within
+   that height, and none does out of it. */
+int stream_distance(StreamShape shape, int dx, int dy, int dz) noexcept;
+
+// false for rows a shape never streams
+inline bool stream_row(StreamShape shape, int cy) noexcept {
+    return shape != StreamShape::Cylinder ||
+           (cy >= 0 && cy <= int(Chunk::MAX_HEIGHT_CHUNKS));
+} // stream_row
+
+// a cylinder stays on the rows of the world when the camera leaves them
+inline Chunk::Key clamp_stream_center(StreamShape shape,
+                                      const Chunk::Key &camera) noexcept {
+    if (shape != StreamShape::Cylinder)
+        return camera;
+    const int top = int(Chunk::MAX_HEIGHT_CHUNKS);
+    return {camera.x, camera.y < 0 ? 0 : (camera.y > top ? top : camera.y),
+            camera.z};
+} // clamp_stream_center
+
+/* The offsets from a stream center within `radius`, built once per shape
+   and radius. Streaming walks `offsets`; moving the center by one chunk
+   brings `boundary` of the step's direction into range around the new
+   center and takes the one of the opposite direction out of range around
+   the old one. */
+struct StreamVolume {
+    StreamShape shape;
+    int radius;
+
+    // nearest first, then by the euclidean distance
+    std::vector<Chunk::Key> offsets;
+    // [axis][sign < 0]: the offsets one step along which is out of range
+    std::vector<Chunk::Key> boundary[3][2];
+
+    StreamVolume(StreamShape shape, int radius);
+
+    bool contains(const Chunk::Key &center,
+                  const Chunk::Key &key) const noexcept {
+        return stream_row(shape, key.y) &&
+               stream_distance(shape, key.x - center.x, key.y - center.y,
+                               key.z - center.z) <= radius;
+    }
+}; // struct StreamVolume
+
+} // namespace hi
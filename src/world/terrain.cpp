@@ -1,5 +1,6 @@
 #include "terrain.hpp"
 
+#include "../higui/platform.hpp"
 #include "../resources/shaders.hpp"
 
 #include "block_list.hpp"
@@ -8,41 +9,59 @@
 
 namespace hi {
 
-bool Terrain::allocate_chunk_slot(GLuint count, GLuint &out_offset) {
-    for (size_t i = 0; i < free_slots.size(); ++i) {
-        if (free_slots[i].count >= count) {
-            out_offset = free_slots[i].offset;
-            if (free_slots[i].count == count) {
-                free_slots.erase(free_slots.begin() + i);
-            } else {
-                free_slots[i].offset += count;
-                free_slots[i].count -= count;
-            }
-            return true;
-        }
-    }
+// steps between two chunks, one axis at a time
+static int manhattan(const Chunk::Key &o) noexcept {
+    return std::abs(o.x) + std::abs(o.y) + std::abs(o.z);
+}
 
-    if (used_vertices + count > TOTAL_VERT_CAP)
-        return false;
+// built once for every shape, to load within and to unload beyond
+static const StreamVolume &stream_volume(StreamShape shape,
+                                         bool unload) noexcept {
+    static const StreamVolume volumes[3][2] = {
+        {{StreamShape::Octahedron, Terrain::STREAM_RADIUS},
+         {StreamShape::Octahedron, Terrain::UNLOAD_RADIUS}},
+        {{StreamShape::Sphere, Terrain::STREAM_RADIUS},
+         {StreamShape::Sphere, Terrain::UNLOAD_RADIUS}},
+        {{StreamShape::Cylinder, Terrain::STREAM_RADIUS},
+         {StreamShape::Cylinder, Terrain::UNLOAD_RADIUS}},
+    };
+    return volumes[int(shape)][unload];
+} // stream_volume
 
-    out_offset = used_vertices;
-    used_vertices += count;
-    return true;
+static int &component(Chunk::Key &key, int axis) noexcept {
+    return axis == 0 ? key.x : (axis == 1 ? key.y : key.z);
 }
 
-void Terrain::free_chunk_slot(GLuint offset, GLuint count) {
-    free_slots.push_back({offset, count});
+// leaves two cores to the main thread and the driver, see
+// `JobSystem::set_worker_count` for tuning
+static unsigned default_worker_count() noexcept {
+    unsigned num_threads = std::thread::hardware_concurrency();
+    return (num_threads <= 2) ? 1 : num_threads - 2;
 }
 
-Terrain::Terrain() noexcept : shader_program{terrain_vert, terrain_frag} {
-    // vao, vbo
-    vbo.bind(GL_ARRAY_BUFFER);
-    vbo.buffer_data(GL_ARRAY_BUFFER, TOTAL_VERT_CAP * sizeof(Vertex), nullptr,
-                    GL_STATIC_DRAW);
+Terrain::Terrain() noexcept
+    : shader_program{terrain_vert, terrain_frag},
+      jobs{default_worker_count()} {
+    // face records, read by the vertex shader as buffer textures; pages
+    // are allocated as chunks come in
+    arena.init(TOTAL_FACE_CAP);
 
+    // no vertex attributes, the vao only keeps the quad indices
     vao.bind();
-    vbo.bind(GL_ARRAY_BUFFER);
-    bind_vertex_attributes();
+
+    // quad indices, bound to the vao
+    {
+        std::vector<uint16_t> indices(QUADS_PER_DRAW * 6);
+        for (unsigned quad = 0; quad < QUADS_PER_DRAW; ++quad) {
+            constexpr uint16_t QUAD[6] = {0, 1, 2, 0, 2, 3};
+            for (unsigned i = 0; i < 6; ++i)
+                indices[quad * 6 + i] = uint16_t(quad * 4 + QUAD[i]);
+        }
+        quad_ebo.bind(GL_ELEMENT_ARRAY_BUFFER);
+        quad_ebo.buffer_data(GL_ELEMENT_ARRAY_BUFFER,
+                             indices.size() * sizeof(uint16_t), indices.data(),
+                             GL_STATIC_DRAW);
+    }
 
     // shader program
     shader_program.use();
@@ -50,6 +69,12 @@ Terrain::Terrain() noexcept : shader_program{terrain_vert, terrain_frag} {
         glGetUniformLocation(shader_program.get(), "projection");
     view_location = glGetUniformLocation(shader_program.get(), "view");
     atlas_location = glGetUniformLocation(shader_program.get(), "atlas");
+    faces_location = glGetUniformLocation(shader_program.get(), "faces");
+    tiles_per_row_location =
+        glGetUniformLocation(shader_program.get(), "tiles_per_row");
+    chunk_origin_location =
+        glGetUniformLocation(shader_program.get(), "chunk_origin");
+    alpha_location = glGetUniformLocation(shader_program.get(), "alpha");
 
     // prepare texture buffer
     constexpr unsigned TEX_SIZE =
@@ -69,131 +94,878 @@ Terrain::Terrain() noexcept : shader_program{terrain_vert, terrain_frag} {
                  atlas_pixels);
     hi::free(atlas_pixels, TEX_SIZE);
 
-    pending_to_request.reserve(MAX_LOADED_CHUNKS);
+}
 
-    // give the job for the workers
-    unsigned num_threads = std::thread::hardware_concurrency();
-    unsigned count = (num_threads <= 4) ? 1 : num_threads - 3;
+void Terrain::generate_next() noexcept {
+    Key key;
+    {
+        std::lock_guard lk(mutex_pending);
+        if (!pending.pop(key))
+            return; // dropped when the view moved away
+        std::lock_guard lk_chunks(mutex_chunks);
+        if (!state_map.emplace(key, ChunkState::Requested).second)
+            return; // generated already
+    }
+    generate_job(key);
+}
+
+bool Terrain::is_cancelled(CancelToken &token) const noexcept {
+    const uint32_t epoch = center_epoch.load();
+    if (epoch == token.epoch)
+        return false;
+    token.epoch = epoch;
+
+    return !in_stream_range(token.key);
+}
+
+bool Terrain::in_stream_range(const Key &key, int radius) const noexcept {
+    const StreamShape shape = stream_shape.load(std::memory_order_relaxed);
+    if (!stream_row(shape, key.y))
+        return false;
+    const Key center = center_chunk.load();
+    const Key ahead = ahead_chunk.load();
+    return stream_distance(shape, key.x - center.x, key.y - center.y,
+                           key.z - center.z) <= radius ||
+           stream_distance(shape, key.x - ahead.x, key.y - ahead.y,
+                           key.z - ahead.z) <= radius;
+}
+
+void Terrain::generate_job(const Key &key) noexcept {
+    // starts out of date, so that the range is checked once up front
+    CancelToken token{key, center_epoch.load() - 1};
+    // requested again once back in range
+    auto cancel = [&] {
+        ++cancelled_jobs;
+        std::lock_guard lk(mutex_chunks);
+        if (auto it = state_map.find(key);
+            it != state_map.end() && it->second == ChunkState::Requested)
+            state_map.erase(it);
+    };
+    if (is_cancelled(token)) {
+        cancel();
+        return;
+    }
+
+    // heightfield chunks need no voxels, only their heights, and the air
+    // outside of the world rows neither
+    auto chunk = std::make_shared<Chunk::Data>();
+    if (Chunk::is_world_row(key.y)) {
+        Chunk::generate_heightmap(key.x, key.z, chunk->heights, noise);
+        if (!Chunk::is_heightfield(key.y))
+            Chunk::generate_voxels(key.y, *chunk);
+    }
 
-    workers.reserve(count);
+    if (is_cancelled(token)) {
+        cancel();
+        return;
+    }
+
+    Chunk::Borders borders;
+    Chunk::extract_borders(key.y, *chunk, borders);
+    {
+        // published only by the job that generated it first, as an edit
+        // may have changed the chunk since
+        std::lock_guard lk(mutex_chunks);
+        if (!block_map.emplace(key, std::move(chunk)).second)
+            return;
+        border_map.insert_or_assign(key, borders);
+        // light is part of the generated blocks, so it is lit already
+        state_map[key] = ChunkState::Lit;
+        waiting.insert(key);
+    }
+    generated_chunks.fetch_add(1, std::memory_order_relaxed);
+    schedule_meshes(key);
+}
+
+void Terrain::mesh_job(const Key &key) noexcept {
+    CancelToken token{key, center_epoch.load() - 1};
+    // meshed once back in range, the blocks are kept until unloaded
+    auto cancel = [&] {
+        ++cancelled_jobs;
+        std::lock_guard lk(mutex_chunks);
+        if (auto it = state_map.find(key); it != state_map.end() &&
+                                           it->second >= ChunkState::Lit) {
+            it->second = ChunkState::Lit;
+            waiting.insert(key);
+        }
+    };
+    std::shared_ptr<const Chunk::Data> chunk;
+    if (is_cancelled(token)) {
+        cancel();
+        return;
+    }
+    {
+        std::shared_lock lk(mutex_chunks);
+        auto it = block_map.find(key);
+        if (it == block_map.end())
+            return; // unloaded
+        chunk = it->second;
+    }
+
+    MeshData mesh;
+    mesh.faces.reserve(2048);
+    if (chunk->has_blocks())
+        generate_mesh_for(key, *chunk, mesh);
+    else if (Chunk::is_world_row(key.y))
+        generate_heightfield_mesh(key, chunk->heights, mesh);
+    mesh.version = chunk->version;
+
+    // left the range while being meshed: not worth a slot
+    if (is_cancelled(token)) {
+        cancel();
+        return;
+    }
+    {
+        std::lock_guard lk(mutex_chunks);
+        if (auto it = state_map.find(key); it != state_map.end())
+            it->second = ChunkState::Meshed;
+    }
+    ready.push({key, std::move(mesh)});
+}
+
+bool Terrain::can_mesh(const Key &key) const noexcept {
+    if (!in_stream_range(key))
+        return false;
+    // neighbours out of range are predicted, and patched if they come
+    for (int face = 0; face < 6; ++face) {
+        const Key neighbor = Chunk::neighbor_key(key, face);
+        if (!in_stream_range(neighbor))
+            continue;
+        auto it = state_map.find(neighbor);
+        if (it == state_map.end() || it->second < ChunkState::Generated)
+            return false;
+    }
+    return true;
+}
+
+void Terrain::schedule_meshes(const Key &key) noexcept {
+    Key ready_keys[7];
+    unsigned count = 0;
+    {
+        std::lock_guard lk(mutex_chunks);
+        for (int face = -1; face < 6; ++face) {
+            const Key k = face < 0 ? key : Chunk::neighbor_key(key, face);
+            if (waiting.contains(k) && can_mesh(k)) {
+                waiting.erase(k);
+                ready_keys[count++] = k;
+            }
+        }
+    }
     for (unsigned i = 0; i < count; ++i) {
-        workers.emplace_back([this] {
-            while (running) {
-                Key key;
-                {
-                    std::unique_lock lk(mutex_pending);
-                    cv.wait(lk,
-                            [&] { return !pending_queue.empty() || !running; });
-                    if (!running)
-                        break;
-                    key = pending_queue.top().key;
-                    pending_queue.pop();
-                    pending_set.erase(key);
-                }
+        const Key k = ready_keys[i];
+        jobs.submit(JobSystem::High, [this, k] { mesh_job(k); });
+    }
+}
 
-                Key center = center_chunk.load();
-                int dist = std::abs(center.x - key.x) +
-                           std::abs(center.y - key.y) +
-                           std::abs(center.z - key.z);
-                if (dist > STREAM_RADIUS)
-                    continue;
+void Terrain::schedule_waiting() noexcept {
+    std::vector<Key> ready_keys;
+    {
+        std::lock_guard lk(mutex_chunks);
+        for (auto it = waiting.begin(); it != waiting.end();) {
+            if (can_mesh(*it)) {
+                ready_keys.push_back(*it);
+                it = waiting.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+    for (const Key &k : ready_keys)
+        jobs.submit(JobSystem::High, [this, k] { mesh_job(k); });
+}
+
+bool Terrain::request_chunk(const Key &key) {
+    if (!in_stream_range(key))
+        return false;
+    {
+        // jobs give a chunk its state under both locks as they take it
+        std::lock_guard lk(mutex_pending);
+        {
+            std::shared_lock lk_chunks(mutex_chunks);
+            if (state_map.contains(key))
+                return false;
+        }
+        if (!pending.push(key))
+            return false;
+    }
+    // which chunk a job generates is decided when it starts, see
+    // `ChunkQueue`
+    jobs.submit(JobSystem::Normal, [this] { generate_next(); });
+    return true;
+}
+
+void Terrain::request_remesh(const Key &key) {
+    jobs.submit(JobSystem::High, [this, key] { mesh_job(key); });
+}
+
+void Terrain::recenter(const Key &camera) noexcept {
+    const Key center = clamp_stream_center(stream_shape.load(), camera);
+    center_chunk.store(center);
+    ahead_chunk.store(center); // until the next `update_view`
+    center_epoch.fetch_add(1);
+
+    const int steps[3] = {center.x - stream_center.x,
+                          center.y - stream_center.y,
+                          center.z - stream_center.z};
+    if (stream_filled && std::abs(steps[0]) + std::abs(steps[1]) +
+                                 std::abs(steps[2]) <=
+                             MAX_DELTA_STEPS) {
+        // a chunk at a time, each moves one slab of the shell
+        for (int axis = 0; axis < 3; ++axis)
+            for (int i = 0; i < std::abs(steps[axis]); ++i)
+                step_center(axis, steps[axis] < 0 ? -1 : 1);
+    } else {
+        {
+            std::lock_guard lk(mutex_pending);
+            cancelled_jobs += pending.set_center(center);
+        }
+        exposed.clear();
+        stream_center = center;
+        prefetch_center = center;
+        stream_index = 0;
+        streaming = true;
+        stream_filled = false;
+
+        // anything may be out of range now, unloaded with the same budget
+        departed.assign(loaded_chunks.begin(), loaded_chunks.end());
+        std::shared_lock lk(mutex_chunks);
+        for (const auto &[key, blocks] : block_map)
+            if (!loaded_chunks.contains(key))
+                departed.push_back(key);
+    }
+
+    // neighbours may have left the range, or chunks come back into it
+    schedule_waiting();
+}
 
-                auto blocks =
-                    std::make_unique<Block[]>(Chunk::BLOCKS_PER_CHUNK);
-                Chunk::generate_chunk(key.x, key.y, key.z, blocks.get(), noise);
-                std::vector<Vertex> mesh;
-                mesh.reserve(2048);
+void Terrain::step_center(int axis, int sign) noexcept {
+    const Key previous = stream_center;
+    Key next = previous;
+    component(next, axis) += sign;
 
-                generate_mesh_for(key, blocks.get(), mesh);
+    // the chunks left behind at the edge of either radius are one step
+    // out of it now, unless they are around the predicted center
+    const StreamShape shape = stream_shape.load();
+    const auto &load = stream_volume(shape, false).boundary[axis][sign > 0];
+    const auto &unload = stream_volume(shape, true).boundary[axis][sign > 0];
+    size_t dropped = 0;
+    {
+        std::lock_guard lk(mutex_pending);
+        for (const Key &offset : load) {
+            const Key key{previous.x + offset.x, previous.y + offset.y,
+                          previous.z + offset.z};
+            if (!in_stream_range(key))
+                dropped += pending.erase(key);
+        }
+        pending.move_center(next);
+    }
+    cancelled_jobs += dropped;
+    for (const Key &offset : unload)
+        departed.push_back({previous.x + offset.x, previous.y + offset.y,
+                            previous.z + offset.z});
+
+    expose_slab(next, axis, sign);
+    stream_center = next;
+}
+
+void Terrain::expose_slab(const Key &center, int axis, int sign) {
+    // around `center`, one step out of the radius around the one before
+    const StreamShape shape = stream_shape.load();
+    for (const Key &offset :
+         stream_volume(shape, false).boundary[axis][sign < 0])
+        if (stream_row(shape, center.y + offset.y))
+            exposed.push_back({center.x + offset.x, center.y + offset.y,
+                               center.z + offset.z});
+}
+
+void Terrain::prefetch(const Key &ahead) {
+    if (!stream_filled)
+        return; // the walk gets there
+    auto distance = [](const Key &a, const Key &b) {
+        return manhattan({a.x - b.x, a.y - b.y, a.z - b.z});
+    };
+    // start over unless already on the way from the center to `ahead`
+    if (distance(stream_center, prefetch_center) +
+            distance(prefetch_center, ahead) !=
+        distance(stream_center, ahead))
+        prefetch_center = stream_center;
+
+    const int steps[3] = {ahead.x - prefetch_center.x,
+                          ahead.y - prefetch_center.y,
+                          ahead.z - prefetch_center.z};
+    for (int axis = 0; axis < 3; ++axis)
+        for (int i = 0; i < std::abs(steps[axis]); ++i) {
+            const int sign = steps[axis] < 0 ? -1 : 1;
+            component(prefetch_center, axis) += sign;
+            expose_slab(prefetch_center, axis, sign);
+        }
+}
+
+void Terrain::update_view(const math::mat4x4 projection,
+                          const math::mat4x4 view, const math::vec3 forward,
+                          const math::vec3 velocity) noexcept {
+    const StreamShape shape = stream_shape.load();
+    ChunkQueue::View next;
+    next.center = center_chunk.load();
+
+    // where the camera will be, in chunks and within the stream radius
+    const float chunk_size[3] = {float(Chunk::WIDTH), float(Chunk::HEIGHT),
+                                 float(Chunk::DEPTH)};
+    float lead[3];
+    float lead_length = 0.f;
+    for (int i = 0; i < 3; ++i) {
+        lead[i] = velocity[i] * PREFETCH_SECONDS / chunk_size[i];
+        lead_length += lead[i] < 0.f ? -lead[i] : lead[i];
+    }
+    const float scale = lead_length > float(STREAM_RADIUS)
+                            ? float(STREAM_RADIUS) / lead_length
+                            : 1.f;
+    const Key ahead{int(math::floorf(lead[0] * scale + 0.5f)),
+                    int(math::floorf(lead[1] * scale + 0.5f)),
+                    int(math::floorf(lead[2] * scale + 0.5f))};
+    next.ahead = clamp_stream_center(
+        shape, {next.center.x + ahead.x, next.center.y + ahead.y,
+                next.center.z + ahead.z});
+    next.behind_radius =
+        std::max(STREAM_RADIUS / 4, STREAM_RADIUS - 2 * manhattan(ahead));
+    for (int i = 0; i < 3; ++i)
+        next.forward[i] = forward[i];
+
+    math::mat4x4 frustum_view;
+    math::mat4x4_mul(frustum_view, projection, view);
+    Chunk::extract_frustum_planes(next.frustum_planes, frustum_view);
+    memcpy(frustum_planes, next.frustum_planes, sizeof(frustum_planes));
+
+    const bool range_moved = !(next.ahead == ahead_chunk.load());
+    if (range_moved) {
+        ahead_chunk.store(next.ahead);
+        center_epoch.fetch_add(1);
+        prefetch(next.ahead);
+    }
+    size_t queued_again;
+    {
+        std::lock_guard lk(mutex_pending);
+        queued_again = pending.set_view(next);
+    }
+    // deferred behind the camera and within `behind_radius` again
+    for (size_t i = 0; i < queued_again; ++i)
+        jobs.submit(JobSystem::Normal, [this] { generate_next(); });
+    // chunks cancelled while out of range may be back in it
+    if (range_moved)
+        schedule_waiting();
+}
+
+size_t Terrain::frustum_holes() const noexcept {
+    const StreamShape shape = stream_shape.load();
+    const Key center = center_chunk.load();
+    size_t holes = 0;
+    for (const Key &offset : stream_volume(shape, false).offsets) {
+        const Key key{center.x + offset.x, center.y + offset.y,
+                      center.z + offset.z};
+        if (stream_row(shape, key.y) && !mesh_map.contains(key) &&
+            Chunk::is_chunk_visible(key, frustum_planes))
+            ++holes;
+    }
+    return holes;
+}
+
+void Terrain::set_stream_shape(StreamShape shape,
+                               const Key &camera) noexcept {
+    if (shape == stream_shape.load())
+        return;
+    stream_shape.store(shape);
+    {
+        std::lock_guard lk(mutex_pending);
+        pending.set_shape(shape);
+    }
+    stream_filled = false; // streams the new volume from the center
+    recenter(camera);
+}
 
-                {
-                    std::lock_guard lk_ready(mutex_ready);
-                    ready.push({key, std::move(mesh)});
+void Terrain::upload_ready_chunks(double frame_time) {
+    const bool slow = frame_time > UPLOAD_FRAME_TARGET &&
+                      frame_time > UPLOAD_SLOW_FRAME * frame_average;
+    frame_average += (frame_time - frame_average) / 16.0;
+    upload_share = slow ? std::max(UPLOAD_MIN_SHARE, upload_share * 0.5f)
+                        : std::min(1.f, upload_share + UPLOAD_SHARE_STEP);
+    ready.consume_all([this](std::pair<Key, MeshData> &&item) {
+        uploads.push_back(std::move(item));
+    });
+
+    const size_t max_bytes = size_t(upload_share * UPLOAD_MAX_BYTES);
+    const double deadline = time() + upload_share * UPLOAD_MAX_SECONDS;
+    size_t bytes = 0;
+    for (; !uploads.empty(); uploads.pop_front()) {
+        auto &[key, mesh] = uploads.front();
+        const size_t size = mesh.faces.size() * sizeof(FaceRecord);
+        if (bytes && (bytes + size > max_bytes || time() > deadline))
+            break;
+
+        // unloaded since, or meshed from blocks an edit has replaced since
+        unsigned version;
+        {
+            std::shared_lock lk_chunks(mutex_chunks);
+            auto it = block_map.find(key);
+            if (it == block_map.end())
+                continue;
+            version = it->second->version;
+        }
+        if (mesh.version != version) {
+            if (mesh_map.contains(key))
+                continue; // the edit has remeshed it already
+            request_remesh(key);
+        }
+
+        upload_mesh(key, mesh);
+        bytes += size;
+    }
+
+    // a job per chunk, however many of its sides were patched
+    for (const Key &key : stale_edges)
+        request_remesh(key);
+    stale_edges.clear();
+}
+
+void Terrain::compact_faces() {
+    const unsigned page = arena.compaction_page();
+    if (page == FaceArena::NONE)
+        return;
+
+    // a mesh at least, each draws from its new slot from the next frame
+    const size_t max_bytes = size_t(upload_share * COMPACT_MAX_BYTES);
+    size_t bytes = 0;
+    for (auto &[key, mesh] : mesh_map) {
+        if (mesh.page != page || !mesh.face_count)
+            continue;
+        const size_t size = size_t(mesh.face_count) * sizeof(FaceRecord);
+        if (bytes && bytes + size > max_bytes)
+            break;
+        FaceArena::Slot slot{mesh.page, mesh.face_offset};
+        if (!arena.move(slot, mesh.face_count))
+            break;
+        mesh.page = slot.page;
+        mesh.face_offset = slot.offset;
+        bytes += size;
+    }
+}
+
+void Terrain::upload_mesh(const Key &key, const MeshData &mesh,
+                          unsigned slack) {
+    std::vector<FaceRecord> padded;
+    MeshData::RangeCounts range_counts;
+    memcpy(range_counts, mesh.range_counts, sizeof(range_counts));
+    unsigned padding[2][6] = {}; // records added per [liquid][direction]
+    if (slack && mesh.sectioned) {
+        /* Sections and edge slices without faces get no room: most are all
+           air or all ground, and the first edit in one remeshes the chunk
+           with room in it. A bit per section, then per edge slice. */
+        auto bit = [](int face, unsigned range) {
+            return 1u << (range < Chunk::SECTIONS ? range
+                                                  : Chunk::SECTIONS + face);
+        };
+        unsigned filled = 0;
+        for (int liquid = 0; liquid < 2; ++liquid)
+            for (int face = 0; face < 6; ++face)
+                for (unsigned range = 0; range <= Chunk::SECTIONS; ++range)
+                    if (range_counts[liquid][face][range])
+                        filled |= bit(face, range);
+
+        const FaceRecord *src = mesh.faces.data();
+        padded.reserve(mesh.faces.size() + sizeof(range_counts) /
+                                               sizeof(unsigned) * slack);
+        for (int liquid = 0; liquid < 2; ++liquid)
+            for (int face = 0; face < 6; ++face)
+                for (unsigned range = 0; range <= Chunk::SECTIONS; ++range) {
+                    unsigned &count = range_counts[liquid][face][range];
+                    padded.insert(padded.end(), src, src + count);
+                    src += count;
+                    if (!(filled & bit(face, range)))
+                        continue;
+                    padded.resize(padded.size() + slack, FaceRecord::empty());
+                    count += slack;
+                    padding[liquid][face] += slack;
                 }
+    }
+    const auto &faces = padded.empty() ? mesh.faces : padded;
+
+    if (auto it = mesh_map.find(key); it != mesh_map.end()) {
+        arena.free({it->second.page, it->second.face_offset},
+                   it->second.face_count);
+        loaded_faces -= it->second.face_count;
+        mesh_map.erase(it);
+    }
+    layout_map.erase(key);
+    assumed_edges.erase(key);
+
+    FaceArena::Slot slot;
+    if (!arena.allocate(unsigned(faces.size()), slot)) {
+        fprintf(stderr, "[ERROR] No space for chunk at (%d,%d,%d)\n", key.x,
+                key.y, key.z);
+        return;
+    }
+    if (!faces.empty())
+        arena.write(slot, 0, unsigned(faces.size()), faces.data());
+
+    Chunk::Mesh &entry = mesh_map[key];
+    entry.page = slot.page;
+    entry.face_offset = slot.offset;
+    entry.face_count = static_cast<unsigned>(faces.size());
+    entry.liquid_count = 0;
+    for (int face = 0; face < 6; ++face) {
+        entry.direction_counts[face] =
+            mesh.direction_counts[face] + padding[0][face];
+        entry.liquid_count += padding[1][face];
+    }
+    entry.liquid_count += mesh.liquid_count;
+    entry.world_x = float(int(key.x * Chunk::WIDTH));
+    entry.world_y = float(int(key.y * Chunk::HEIGHT));
+    entry.world_z = float(int(key.z * Chunk::DEPTH));
+    loaded_chunks.insert(key);
+    loaded_faces += faces.size();
 
-                {
-                    std::lock_guard lk_pending(mutex_pending);
-                    block_map.emplace(key, std::move(blocks));
+    if (mesh.sectioned) {
+        MeshLayout &layout = layout_map[key];
+        unsigned first = 0;
+        for (int liquid = 0; liquid < 2; ++liquid)
+            for (int face = 0; face < 6; ++face)
+                for (unsigned range = 0; range <= Chunk::SECTIONS; ++range) {
+                    const unsigned count = range_counts[liquid][face][range];
+                    layout.first[liquid][face][range] = first;
+                    layout.count[liquid][face][range] = count;
+                    first += count;
                 }
-            }
-        });
     }
+    if (mesh.assumed_sides)
+        assumed_edges[key] = AssumedEdges{mesh.assumed_sides, mesh.assumed};
+    {
+        std::lock_guard lk(mutex_chunks);
+        if (auto it = state_map.find(key); it != state_map.end())
+            it->second = ChunkState::Uploaded;
+    }
+    settle_edges(key);
 }
 
-Terrain::~Terrain() noexcept {
-    running = false;
-    cv.notify_all();
-    for (auto &worker : workers)
-        if (worker.joinable())
-            worker.join();
+bool Terrain::write_range(const Key &key, int liquid, int face, unsigned range,
+                          const FaceRecord *faces, unsigned count) {
+    auto mesh = mesh_map.find(key);
+    auto layout = layout_map.find(key);
+    if (mesh == mesh_map.end() || layout == layout_map.end())
+        return false;
+    const unsigned first = layout->second.first[liquid][face][range];
+    const unsigned capacity = layout->second.count[liquid][face][range];
+    if (count > capacity)
+        return false;
+    if (!capacity)
+        return true;
+
+    std::vector<FaceRecord> padded(faces, faces + count);
+    padded.resize(capacity, FaceRecord::empty());
+    arena.write({mesh->second.page, mesh->second.face_offset}, first,
+                capacity, padded.data());
+    return true;
+}
+
+void Terrain::settle_edges(const Key &key) {
+    Chunk::Borders borders;
+    auto find_borders = [&](const Key &k) {
+        std::shared_lock lk(mutex_chunks);
+        auto it = border_map.find(k);
+        if (it == border_map.end())
+            return false;
+        borders = it->second;
+        return true;
+    };
+    // looked up again after every patch, which may drop the entry
+    auto assumes = [&](const Key &k, int side) {
+        auto it = assumed_edges.find(k);
+        return it != assumed_edges.end() && (it->second.sides >> side) & 1u;
+    };
+
+    // guessed sides of this chunk whose neighbours exist by now
+    for (int side = 0; side < 6; ++side)
+        if (assumes(key, side) && find_borders(Chunk::neighbor_key(key, side)))
+            patch_edge(key, side, borders);
+
+    // neighbours which guessed this chunk
+    if (!find_borders(key))
+        return;
+    for (int face = 0; face < 6; ++face) {
+        const Key nk = Chunk::neighbor_key(key, face);
+        const int side = face ^ 1; // of the neighbour, towards this chunk
+        if (assumes(nk, side))
+            patch_edge(nk, side, borders);
+    }
+}
+
+void Terrain::patch_edge(const Key &key, int side,
+                         const Chunk::Borders &neighbor) {
+    auto it = assumed_edges.find(key);
+    AssumedEdges &edges = it->second;
+    edges.sides &= ~(1u << side);
+
+    const Chunk::BorderPlane &opaque = neighbor.opaque[side ^ 1];
+    const Chunk::BorderPlane &liquid = neighbor.liquid[side ^ 1];
+    const bool guessed_right =
+        !memcmp(&opaque, &edges.assumed.opaque[side], sizeof(opaque)) &&
+        !memcmp(&liquid, &edges.assumed.liquid[side], sizeof(liquid));
+    if (!edges.sides)
+        assumed_edges.erase(it);
+
+    /* Besides the edge slice, the faces of every direction along the
+       border take their AO from the neighbour, and those lie in most
+       ranges of the mesh. Rather than on this thread and outside of the
+       upload budget, a worker meshes the chunk again. */
+    if (!guessed_right)
+        stale_edges.insert(key);
 }
 
-void Terrain::bind_vertex_attributes() const noexcept {
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, sizeof(Vertex),
-                          (void *)offsetof(Vertex, position_block));
-    glEnableVertexAttribArray(1);
-    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex),
-                          (void *)offsetof(Vertex, uv));
+void Terrain::remesh_ranges(const Key &key, unsigned sections,
+                            unsigned edges) {
+    Chunk::BorderPlane opaque_neighbors[6], liquid_neighbors[6];
+    auto assumed = assumed_edges.find(key);
+    for (int face = 0; face < 6; ++face) {
+        Chunk::BorderPlane &opaque = opaque_neighbors[face];
+        Chunk::BorderPlane &liquid = liquid_neighbors[face];
+        if (get_neighbor_border(key, face, opaque, liquid))
+            continue;
+        // keep meshing against what the rest of the mesh assumed
+        if (assumed != assumed_edges.end() &&
+            (assumed->second.sides >> face) & 1u) {
+            opaque = assumed->second.assumed.opaque[face];
+            liquid = assumed->second.assumed.liquid[face];
+        } else {
+            memset(&opaque, 0, sizeof(opaque));
+            memset(&liquid, 0, sizeof(liquid));
+        }
+    }
+    remesh_ranges(key, opaque_neighbors, liquid_neighbors, sections, edges);
 }
 
-void Terrain::request_chunk(const Key &key, int center_x, int center_y,
-                            int center_z) {
-    int dist = std::abs(center_x - key.x) + std::abs(center_y - key.y) +
-               std::abs(center_z - key.z);
-    if (dist > STREAM_RADIUS)
+void Terrain::remesh_ranges(const Key &key,
+                            const Chunk::BorderPlane (&opaque_neighbors)[6],
+                            const Chunk::BorderPlane (&liquid_neighbors)[6],
+                            unsigned sections, unsigned edges) {
+    std::shared_ptr<Chunk::Data> chunk;
+    {
+        std::shared_lock lk(mutex_chunks);
+        if (auto it = block_map.find(key); it != block_map.end())
+            chunk = it->second;
+    }
+    if (!chunk || !mesh_map.contains(key))
+        return;
+    if (!layout_map.contains(key)) {
+        remesh_now(key); // a heightfield mesh, without ranges
         return;
-    std::lock_guard lk(mutex_pending);
-    if (!block_map.contains(key) && !pending_set.contains(key)) {
-        pending_queue.push(PrioritizedKey{dist, key});
-        pending_set.insert(key);
-        cv.notify_one();
     }
+
+    MeshData mesh;
+    generate_ranges(*chunk, opaque_neighbors, liquid_neighbors, sections,
+                    edges, mesh);
+
+    // the ranges follow each other in `faces` in mesh order
+    const MeshLayout &layout = layout_map[key];
+    auto selected = [&](int face, unsigned range) {
+        return range < Chunk::SECTIONS ? (sections >> range) & 1u
+                                       : (edges >> face) & 1u;
+    };
+    for (int liquid = 0; liquid < 2; ++liquid)
+        for (int face = 0; face < 6; ++face)
+            for (unsigned range = 0; range <= Chunk::SECTIONS; ++range)
+                if (selected(face, range) &&
+                    mesh.range_counts[liquid][face][range] >
+                        layout.count[liquid][face][range]) {
+                    // a range grew past its place: mesh the whole chunk
+                    remesh_now(key);
+                    return;
+                }
+
+    const FaceRecord *faces = mesh.faces.data();
+    for (int liquid = 0; liquid < 2; ++liquid)
+        for (int face = 0; face < 6; ++face)
+            for (unsigned range = 0; range <= Chunk::SECTIONS; ++range) {
+                if (!selected(face, range))
+                    continue;
+                const unsigned count = mesh.range_counts[liquid][face][range];
+                write_range(key, liquid, face, range, faces, count);
+                faces += count;
+            }
+}
+
+void Terrain::remesh_now(const Key &key) {
+    std::shared_ptr<Chunk::Data> chunk;
+    {
+        std::shared_lock lk(mutex_chunks);
+        if (auto it = block_map.find(key); it != block_map.end())
+            chunk = it->second;
+    }
+    // `apply_edits` gives heightfield chunks their voxels before they are
+    // remeshed, and nothing shows in the air outside of the world rows
+    if (!chunk || !chunk->has_blocks())
+        return;
+
+    MeshData mesh;
+    generate_mesh_for(key, *chunk, mesh);
+    mesh.version = chunk->version;
+    upload_mesh(key, mesh, EDIT_SLACK);
+}
+
+bool Terrain::set_block(int x, int y, int z, Block block) noexcept {
+    const BlockEdit edit{x, y, z, block};
+    return apply_edits({&edit, 1}) == 1;
 }
 
-void Terrain::upload_ready_chunks() {
-    std::lock_guard lk(mutex_ready);
-    while (!ready.empty()) {
-        auto [key, verts] = std::move(ready.front());
-        ready.pop();
+unsigned Terrain::apply_edits(std::span<const BlockEdit> edits) noexcept {
+    // ranges to remesh per chunk: bit per section and per edge slice
+    struct Dirty {
+        unsigned sections = 0;
+        unsigned edges = 0;
+    }; // struct Dirty
+    std::unordered_map<Key, std::shared_ptr<Chunk::Data>, Key::Hash> copies;
+    std::unordered_map<Key, Dirty, Key::Hash> dirty;
 
-        GLuint offset = 0;
-        if (!allocate_chunk_slot(verts.size(), offset)) {
-            fprintf(stderr, "[ERROR] No space for chunk at (%d,%d,%d)\n", key.x,
-                    key.y, key.z);
+    // sections holding the faces around row `y`, their AO included
+    auto sections_around = [](int y) {
+        constexpr int H = Chunk::SECTION_HEIGHT;
+        const int lo = std::max(y - 1, 0) / H;
+        const int hi = std::min(y + 1, int(Chunk::HEIGHT) - 1) / H;
+        return ((2u << hi) - 1u) & ~((1u << lo) - 1u);
+    };
+
+    unsigned applied = 0;
+    for (const BlockEdit &edit : edits) {
+        // chunks are 32 blocks wide, so shifts floor negative coordinates
+        const Key key{edit.x >> 5, edit.y >> 5, edit.z >> 5};
+        const int x = edit.x & 31, y = edit.y & 31, z = edit.z & 31;
+
+        auto it = copies.find(key);
+        if (it == copies.end()) {
+            std::shared_ptr<Chunk::Data> chunk;
+            {
+                std::shared_lock lk(mutex_chunks);
+                if (auto found = block_map.find(key); found != block_map.end())
+                    chunk = found->second;
+            }
+            if (!chunk)
+                continue;
+
+            // the workers may still read the published blocks
+            auto copy = std::make_shared<Chunk::Data>(*chunk);
+            if (!copy->has_blocks())
+                Chunk::generate_voxels(key.y, *copy);
+            ++copy->version;
+            it = copies.emplace(key, std::move(copy)).first;
+        }
+        const bool occupancy_changed =
+            Chunk::set_block(*it->second, x, y, z, edit.block);
+        ++applied;
+
+        // the edit's own sections, and the edge slices it lies in
+        const bool on_side[6] = {
+            z == int(Chunk::DEPTH) - 1, z == 0, x == 0,
+            x == int(Chunk::WIDTH) - 1, y == int(Chunk::HEIGHT) - 1, y == 0};
+        Dirty &own = dirty[key];
+        own.sections |= sections_around(y);
+        for (int face = 0; face < 6; ++face)
+            own.edges |= unsigned(on_side[face]) << face;
+        if (!occupancy_changed)
             continue;
+
+        // neighbours only see the occupancy of this chunk's border layers
+        for (int face = 0; face < 6; ++face) {
+            if (!on_side[face])
+                continue;
+            Dirty &other = dirty[Chunk::neighbor_key(key, face)];
+            other.edges |= 1u << (face ^ 1);
+            if (face == 4)
+                other.sections |= 1u; // the bottom of the one above
+            else if (face == 5)
+                other.sections |= 1u << (Chunk::SECTIONS - 1);
+            else
+                other.sections |= sections_around(y);
         }
+    }
 
-        vbo.bind(GL_ARRAY_BUFFER);
-        vbo.sub_data(/* target */ GL_ARRAY_BUFFER,
-                     /* offset */ offset * sizeof(Vertex),
-                     /* size   */ verts.size() * sizeof(Vertex),
-                     /* data   */ verts.data());
-
-        mesh_map[key] =
-            Chunk::Mesh{/* vertex_offset */ offset,
-                        /* vertex_count  */ static_cast<unsigned>(verts.size()),
-                        /* world_x       */ float(int(key.x * Chunk::WIDTH)),
-                        /* world_y       */ float(int(key.y * Chunk::HEIGHT)),
-                        /* world_z       */ float(int(key.z * Chunk::DEPTH))};
-        loaded_chunks.insert(key);
-    }
-}
-
-void Terrain::unload_chunks_not_in(
-    const std::unordered_set<Key, Key::Hash> &active) {
-    for (auto it = loaded_chunks.begin(); it != loaded_chunks.end();) {
-        if (!active.contains(*it)) {
-            const auto &mesh = mesh_map[*it];
-            free_chunk_slot(mesh.vertex_offset, mesh.vertex_count);
-            mesh_map.erase(*it);
-            block_map.erase(*it);
-            neighbor_cache.erase(*it);
-            it = loaded_chunks.erase(it);
-        } else {
-            ++it;
+    /* A heightfield neighbour is meshed from its heights, which know
+       nothing of the edit: mesh it from blocks from now on, whether it has
+       been meshed yet or not. */
+    for (const auto &[key, ranges] : dirty) {
+        if (copies.contains(key) || !Chunk::is_world_row(key.y))
+            continue;
+        std::shared_ptr<Chunk::Data> chunk;
+        {
+            std::shared_lock lk(mutex_chunks);
+            if (auto found = block_map.find(key); found != block_map.end())
+                chunk = found->second;
         }
+        if (!chunk || chunk->has_blocks())
+            continue;
+        auto copy = std::make_shared<Chunk::Data>(*chunk);
+        Chunk::generate_voxels(key.y, *copy);
+        ++copy->version;
+        copies.emplace(key, std::move(copy));
+    }
+
+    // publish the copies, workers pick them up from now on
+    for (auto &[key, chunk] : copies) {
+        Chunk::Borders borders;
+        Chunk::extract_borders(key.y, *chunk, borders);
+        std::lock_guard lk(mutex_chunks);
+        border_map.insert_or_assign(key, borders);
+        block_map.insert_or_assign(key, chunk);
+    }
+
+    for (const auto &[key, ranges] : dirty)
+        remesh_ranges(key, ranges.sections, ranges.edges);
+    return applied;
+}
+
+void Terrain::free_mesh(const Key &key) {
+    auto it = mesh_map.find(key);
+    if (it == mesh_map.end())
+        return;
+    arena.free({it->second.page, it->second.face_offset},
+               it->second.face_count);
+    loaded_faces -= it->second.face_count;
+    mesh_map.erase(it);
+    layout_map.erase(key);
+    assumed_edges.erase(key);
+}
+
+std::shared_ptr<Chunk::Data> Terrain::unload_chunk(const Key &key) {
+    if (loaded_chunks.erase(key))
+        free_mesh(key);
+
+    std::shared_ptr<Chunk::Data> blocks;
+    std::lock_guard lk(mutex_chunks);
+    if (auto it = block_map.find(key); it != block_map.end()) {
+        blocks = std::move(it->second);
+        block_map.erase(it);
     }
+    border_map.erase(key);
+    waiting.erase(key);
+    // a running job still holds the key of a chunk it generates
+    if (auto it = state_map.find(key);
+        it != state_map.end() && it->second != ChunkState::Requested)
+        state_map.erase(it);
+    return blocks;
+}
+
+void Terrain::unload_all_chunks() {
+    for (const Key &key : loaded_chunks)
+        free_mesh(key);
+    loaded_chunks.clear();
+    uploads.clear();
+    ready.clear();
+    sweep.clear();
+    stale_edges.clear();
+
+    std::lock_guard lk(mutex_chunks);
+    border_map.clear();
+    block_map.clear();
+    waiting.clear();
+    std::erase_if(state_map, [](const auto &entry) {
+        return entry.second != ChunkState::Requested;
+    });
 }
 
 inline float distance_squared(const math::vec3 a, float x, float y,
@@ -213,6 +985,13 @@ void Terrain::draw(const math::mat4x4 projection, const math::mat4x4 view,
     glActiveTexture(GL_TEXTURE1);
     atlas.bind(GL_TEXTURE_2D);
     /* atlas */ glUniform1i(atlas_location, 1);
+    /* tiles_per_row */ glUniform1f(
+        tiles_per_row_location,
+        float(TEXTUREPACK_ATLAS_WIDTH / Block::TextureProtocol::RESOLUTION));
+
+    // face records, the page of each chunk is bound below
+    glActiveTexture(GL_TEXTURE2);
+    /* faces */ glUniform1i(faces_location, 2);
 
     /* projection */ glUniformMatrix4fv(
         /* location  */ projection_location,
@@ -224,6 +1003,7 @@ void Terrain::draw(const math::mat4x4 projection, const math::mat4x4 view,
                                   /* count     */ 1,
                                   /* transpose */ GL_FALSE,
                                   /* value     */ (const GLfloat *)view);
+    /* alpha */ glUniform1f(alpha_location, 1.f);
 
     // frustum culling
     float frustum_planes[6][4];
@@ -239,7 +1019,7 @@ void Terrain::draw(const math::mat4x4 projection, const math::mat4x4 view,
     drawlist.reserve(mesh_map.size());
 
     for (const auto &[key, mesh] : mesh_map) {
-        if (mesh.vertex_count == 0)
+        if (mesh.face_count == 0)
             continue;
         if (!Chunk::is_chunk_visible(mesh, frustum_planes))
             continue;
@@ -256,56 +1036,147 @@ void Terrain::draw(const math::mat4x4 projection, const math::mat4x4 view,
                   return da < db; // або > для back-to-front
               });
 
-    // render chunks
-    for (const auto *mesh : drawlist) {
-        glDrawArrays(GL_TRIANGLES, mesh->vertex_offset, mesh->vertex_count);
-    }
-}
-
-void Terrain::update(int center_cx, int center_cy, int center_cz) noexcept {
-    // 1. Formation of chunks by waves
-    if (filling_pending) {
-
-        int cx = pending_center.x;
-        int cy = pending_center.y;
-        int cz = pending_center.z;
-
-        for (int dz = -wave_radius; dz <= wave_radius; ++dz)
-            for (int dy = -wave_radius; dy <= wave_radius; ++dy)
-                for (int dx = -wave_radius; dx <= wave_radius; ++dx) {
-                    if (std::max({std::abs(dx), std::abs(dy), std::abs(dz)}) !=
-                        wave_radius)
-                        continue;
+    // render chunks, a page at a time and nearest first within it
+    std::vector<const Chunk::Mesh *> opaque = drawlist;
+    std::stable_sort(opaque.begin(), opaque.end(),
+                     [](const auto *a, const auto *b) {
+                         return a->page < b->page;
+                     });
+    drawn_faces = 0;
+    unsigned bound_page = UINT32_MAX;
+    for (const auto *mesh : opaque) {
+        if (mesh->page != bound_page) {
+            bound_page = mesh->page;
+            arena.bind(bound_page);
+        }
+        /* chunk_origin */ glUniform3f(chunk_origin_location, mesh->world_x,
+                                       mesh->world_y, mesh->world_z);
 
-                    Chunk::Key key{cx + dx, cy + dy, cz + dz};
-                    pending_to_request.push_back(key);
-                }
+        // skip the direction buckets which face away from the camera,
+        // adjacent visible buckets are drawn as one range
+        const unsigned facing = Chunk::facing_directions(*mesh, camera_pos);
+        unsigned begin = 0, end = 0;
+        for (int face = 0; face <= 6; ++face) {
+            if (face < 6 && (facing >> face) & 1u) {
+                end += mesh->direction_counts[face];
+                continue;
+            }
+            draw_faces(*mesh, begin, end - begin);
+            if (face < 6)
+                end += mesh->direction_counts[face];
+            begin = end;
+        }
+    }
 
-        ++wave_radius;
+    // translucent liquids: back to front over the opaque terrain, without
+    // depth writes and visible from below the surface as well
+    glDepthMask(GL_FALSE);
+    glDisable(GL_CULL_FACE);
+    /* alpha */ glUniform1f(alpha_location, LIQUID_ALPHA);
+    for (auto it = drawlist.rbegin(); it != drawlist.rend(); ++it) {
+        const Chunk::Mesh *mesh = *it;
+        if (mesh->liquid_count == 0)
+            continue;
+        if (mesh->page != bound_page) {
+            bound_page = mesh->page;
+            arena.bind(bound_page);
+        }
+        /* chunk_origin */ glUniform3f(chunk_origin_location, mesh->world_x,
+                                       mesh->world_y, mesh->world_z);
+        draw_faces(*mesh, mesh->face_count - mesh->liquid_count,
+                   mesh->liquid_count);
+    }
+    glEnable(GL_CULL_FACE);
+    glDepthMask(GL_TRUE);
+}
 
-        if (wave_radius > STREAM_RADIUS) {
-            filling_pending = false;
+void Terrain::draw_faces(const Chunk::Mesh &mesh, unsigned first,
+                         unsigned count) const noexcept {
+    for (unsigned done = 0; done < count; done += QUADS_PER_DRAW) {
+        const unsigned quads = std::min(count - done, QUADS_PER_DRAW);
+        glDrawElementsBaseVertex(
+            /* mode       */ GL_TRIANGLES,
+            /* count      */ quads * 6,
+            /* type       */ GL_UNSIGNED_SHORT,
+            /* indices    */ nullptr,
+            /* basevertex */ (mesh.face_offset + first + done) * 4);
+    }
+    drawn_faces += count;
+}
 
-            std::unordered_set<Chunk::Key, Chunk::Key::Hash> needed(
-                pending_to_request.begin(), pending_to_request.end());
-            if (loaded_chunks.size() > MAX_LOADED_CHUNKS)
-                unload_chunks_not_in(needed);
+void Terrain::update() noexcept {
+    // 1. Requesting chunks nearest first, most of them are there already
+    unsigned requested = 0, visited = 0;
+    auto request = [&](const Key &key) {
+        ++visited;
+        requested += request_chunk(key);
+    };
+    auto within_budget = [&] {
+        return requested < STREAM_REQUESTS_PER_FRAME &&
+               visited < STREAM_VISITS_PER_FRAME;
+    };
 
-            pending_index = 0;
+    if (streaming) {
+        const std::vector<Key> &offsets =
+            stream_volume(stream_shape.load(), false).offsets;
+        for (; stream_index < offsets.size() && within_budget();
+             ++stream_index) {
+            const Key &offset = offsets[stream_index];
+            request({stream_center.x + offset.x, stream_center.y + offset.y,
+                     stream_center.z + offset.z});
         }
+        if (stream_index == offsets.size()) {
+            streaming = false;
+            stream_filled = true;
+        }
+    }
+    // the slabs moving across chunk borders exposed
+    for (; !exposed.empty() && within_budget(); exposed.pop_front())
+        request(exposed.front());
+
+    // and the ones they left, past the unload radius so that chunks at the
+    // edge do not come and go with every step, with the ones the sweep
+    // found out of range
+    if (sweep.empty()) {
+        std::shared_lock lk(mutex_chunks);
+        sweep.reserve(block_map.size());
+        for (const auto &[key, blocks] : block_map)
+            sweep.push_back(key);
     }
+    for (unsigned i = 0; i < STREAM_SWEEPS_PER_FRAME && !sweep.empty();
+         ++i, sweep.pop_back())
+        if (!in_stream_range(sweep.back(), UNLOAD_RADIUS))
+            departed.push_back(sweep.back());
 
-    // 2. Requesting chunks to the queue
-    constexpr int chunks_per_frame = 64;
-    for (int i = 0;
-         i < chunks_per_frame && pending_index < pending_to_request.size();
-         ++i, ++pending_index) {
-        const auto &key = pending_to_request[pending_index];
-        request_chunk(key, center_cx, center_cy, center_cz);
+    std::vector<std::shared_ptr<Chunk::Data>> unloaded;
+    for (unsigned i = 0; i < STREAM_UNLOADS_PER_FRAME && !departed.empty();
+         departed.pop_front()) {
+        const Key &key = departed.front();
+        if (in_stream_range(key, UNLOAD_RADIUS))
+            continue;
+        if (auto blocks = unload_chunk(key))
+            unloaded.push_back(std::move(blocks));
+        ++i;
     }
+    // a slab of blocks takes milliseconds to free, not on this thread; on
+    // the high lane, as the lower ones wait for as long as the camera
+    // keeps streaming, and the blocks with them
+    if (!unloaded.empty())
+        jobs.submit(JobSystem::High, [unloaded = std::move(unloaded)] {});
+
+    // 2. Upload ready meshes, fewer after slow frames
+    const double now = time();
+    upload_ready_chunks(last_update > 0.0 ? now - last_update : 0.0);
+    last_update = now;
+
+    // 3. Empty out a page left mostly free by the churn
+    compact_faces();
+}
 
-    // 3. Upload ready meshes
-    upload_ready_chunks();
+void Terrain::reload(const Key &center) noexcept {
+    unload_all_chunks();
+    stream_filled = false;
+    recenter(center);
 }
 
 } // namespace hi
@@ -1,113 +1,386 @@
 #pragma once
 
+#include "../engine/job_system.hpp"
+#include "../engine/mpsc_queue.hpp"
 #include "../engine/opengl.hpp"
 #include "chunk.hpp"
+#include "chunk_queue.hpp"
+#include "face_arena.hpp"
+#include "stream_volume.hpp"
 
 #include <array>
-#include <condition_variable>
 #include <cstdint>
+#include <deque>
 #include <memory>
 #include <mutex>
-#include <queue>
-#include <thread>
+#include <shared_mutex>
+#include <span>
 #include <unordered_map>
 #include <unordered_set>
 #include <vector>
 
 namespace hi {
 
-struct Vertex {
-    math::vec4 position_block;
-    math::vec2 uv;
-    math::vec2 padding;
-}; // struct Vertex
+/* One visible (possibly merged) face, 8 bytes. Nothing else is stored per
+   face: terrain.vert pulls the record from a buffer texture and rebuilds
+   the 4 corners from gl_VertexID, the chunk origin comes as a uniform.
+
+   position_size: 0000 | 00000 | 00000 | 000 | 00000 | 00000 | 00000
+                  res. | h - 1 | w - 1 | face | z    | y     | x
+
+   tile_light:    0000'0000 | 00'00'00'00 | 0000 | 0000'0000'0000
+                  reserved  | ao TL..BL   | light | atlas tile
+
+   (x, y, z) is the lowest block of the face inside the chunk, `w` and `h`
+   extend it along the face's texture axes u and v. */
+struct FaceRecord {
+    uint32_t position_size;
+    uint32_t tile_light;
+
+    static constexpr uint32_t make_position_size(unsigned x, unsigned y,
+                                                 unsigned z, unsigned face,
+                                                 unsigned w,
+                                                 unsigned h) noexcept {
+        return (x & 0x1F) | ((y & 0x1F) << 5) | ((z & 0x1F) << 10) |
+               ((face & 0x7) << 15) | (((w - 1) & 0x1F) << 18) |
+               (((h - 1) & 0x1F) << 23);
+    }
+    // `ao` holds 2 bits per corner: BL, BR, TR, TL from the lowest bits
+    static constexpr uint32_t make_tile_light(unsigned tile, unsigned light,
+                                              unsigned ao = 0) noexcept {
+        return (tile & 0x0FFF) | ((light & 0x0F) << 12) | ((ao & 0xFF) << 16);
+    }
+    // fills the rest of a patched range, terrain.vert drops it (face 7)
+    static constexpr FaceRecord empty() noexcept { return {7u << 15, 0}; }
+}; // struct FaceRecord
+static_assert(sizeof(FaceRecord) == FaceArena::FACE_BYTES);
+
+/* Faces of one chunk: opaque ones grouped by direction in `Block::CUBE_POS`
+   order, then the translucent ones, grouped the same way. Within a
+   direction the faces are ordered by `Chunk::SECTIONS`, and the faces of
+   the chunk's outermost slice on that side close it: the only ones which
+   depend on the neighbour there. Heightfield meshes have no such ranges. */
+struct MeshData {
+    // [liquid][direction][section], the last range is the edge slice
+    using RangeCounts = unsigned[2][6][Chunk::SECTIONS + 1];
+
+    std::vector<FaceRecord> faces;
+    unsigned direction_counts[6] = {};
+    unsigned liquid_count = 0;
+    RangeCounts range_counts = {};
+    bool sectioned = false;
+    unsigned version = 0; // of the `Chunk::Data` meshed
+
+    // sides meshed against a guessed neighbour border, and those guesses
+    unsigned assumed_sides = 0;
+    Chunk::Borders assumed;
+}; // struct MeshData
 
 struct Terrain {
-    struct FreeSlot {
-        GLuint offset;
-        GLuint count;
-    }; // struct FreeSlot
+    // what meshing assumes behind a side whose neighbour is not generated
+    enum class EdgeGuess {
+        Predicted, // the generator's result, from the column heights
+        Empty,     // all faces shown, patched away later
+        Solid,     // no faces shown, holes until patched
+    };
+
+    // a loaded chunk meshed against guessed neighbour borders, meshed
+    // again once a real neighbour turns out different
+    struct AssumedEdges {
+        unsigned sides; // bit per side still guessed
+        Chunk::Borders assumed;
+    }; // struct AssumedEdges
 
-    struct PrioritizedKey {
-        int priority; // less is better
+    /* Where the `MeshData` ranges of a loaded chunk lie, relative to its
+       `face_offset`. A range is rewritten in place, padded with empty
+       records, as long as its faces fit in the original count. */
+    struct MeshLayout {
+        MeshData::RangeCounts first;
+        MeshData::RangeCounts count;
+    }; // struct MeshLayout
+
+    /* Stages of a chunk once a job took it from `pending`. Light comes
+       with the blocks (`Chunk::column_block`), so a chunk is lit as soon
+       as its blocks are published; Generated is what its neighbours wait
+       for. A lit chunk is meshed once every neighbour is generated or out
+       of the stream radius, and goes back to Lit when its mesh job is
+       cancelled. */
+    enum class ChunkState : uint8_t {
+        Requested, // being generated
+        Generated,
+        Lit,
+        Meshed,   // waiting in `ready` or `uploads`
+        Uploaded, // in `mesh_map`
+    };
+
+    /* Lets a running job notice that its chunk left the stream radius; the
+       distance is checked again only after the center moved. */
+    struct CancelToken {
         Chunk::Key key;
+        uint32_t epoch;
+    }; // struct CancelToken
 
-        bool operator<(const PrioritizedKey &rhs) const noexcept {
-            // less priority handles earlier
-            return priority > rhs.priority; // std::priority_queue — max heap
-        }
-    }; // struct PrioritizedKey
+    struct BlockEdit {
+        int x, y, z; // world block coordinates
+        Block block;
+    }; // struct BlockEdit
 
+    // chunks are loaded within the first and unloaded past the second
     static constexpr int STREAM_RADIUS = 16;
-    static constexpr unsigned MAX_LOADED_CHUNKS = 1024;
-    static constexpr unsigned TOTAL_VERT_CAP =
-        UINT32_MAX / 2.2f / sizeof(Vertex);
+    static constexpr int UNLOAD_RADIUS = STREAM_RADIUS + 2;
+    static constexpr StreamShape DEFAULT_STREAM_SHAPE = StreamShape::Cylinder;
+    // per frame, chunks queued and offsets looked at while streaming
+    static constexpr unsigned STREAM_REQUESTS_PER_FRAME = 64;
+    static constexpr unsigned STREAM_VISITS_PER_FRAME = 1024;
+    static constexpr unsigned STREAM_UNLOADS_PER_FRAME = 64;
+    // generated chunks checked against the unload radius per frame, see
+    // `sweep`
+    static constexpr unsigned STREAM_SWEEPS_PER_FRAME = 64;
+    // how far ahead of a moving camera chunks are fetched first
+    static constexpr float PREFETCH_SECONDS = 1.5f;
+    // chunk borders crossed at once that still move the stream area slab
+    // by slab, a longer jump streams it in again from the center
+    static constexpr int MAX_DELTA_STEPS = 4;
+    /* Meshes uploaded per frame, within a share of both maximums: the
+       share halves after a slow frame, one slower than the target and
+       UPLOAD_SLOW_FRAME times the average frame, and grows back by
+       UPLOAD_SHARE_STEP per frame. One mesh is uploaded per frame at least,
+       the rest waits for the next. */
+    static constexpr size_t UPLOAD_MAX_BYTES = 8u << 20;
+    static constexpr double UPLOAD_MAX_SECONDS = 0.004;
+    static constexpr double UPLOAD_FRAME_TARGET = 1.0 / 60.0;
+    static constexpr double UPLOAD_SLOW_FRAME = 1.5;
+    static constexpr float UPLOAD_MIN_SHARE = 1.f / 16.f;
+    static constexpr float UPLOAD_SHARE_STEP = 1.f / 8.f;
+    // faces copied per frame out of an evacuated page, see
+    // `FaceArena::compaction_page`, scaled by the upload share as well
+    static constexpr size_t COMPACT_MAX_BYTES = 1u << 20;
+    static constexpr unsigned TOTAL_FACE_CAP =
+        UINT32_MAX / 2.2f / sizeof(FaceRecord);
+    // 4 corners per face, indexed through one shared 16-bit index buffer
+    static constexpr unsigned QUADS_PER_DRAW = 65536 / 4;
 
     using Key = Chunk::Key;
+    // occupancy with a one block border taken from the neighbours
+    using PaddedOccupancy = uint64_t[Chunk::DEPTH + 2][Chunk::HEIGHT + 2];
+    // [z][y], bit x
+    using VisibleRows = uint32_t[Chunk::DEPTH][Chunk::HEIGHT];
+    using VisibleFaces = VisibleRows[6]; // per `Block::CUBE_POS` face
 
     NoiseSystem noise;
 
     gl::VAO vao;
-    gl::VBO vbo;
+    gl::EBO quad_ebo;
+    FaceArena arena; // face records, a buffer texture per page
     gl::Texture atlas;
     gl::ShaderProgram shader_program;
     unsigned projection_location = 0;
     unsigned view_location = 0;
     unsigned atlas_location = 0;
+    unsigned faces_location = 0;
+    unsigned tiles_per_row_location = 0;
+    unsigned chunk_origin_location = 0;
+    unsigned alpha_location = 0;
+
+    static constexpr float LIQUID_ALPHA = 0.7f;
+    // room left in every range of an edited chunk, so that the next edits
+    // are written in place
+    static constexpr unsigned EDIT_SLACK = 8;
+
+    // merge coplanar faces into larger quads, toggled for comparison
+    std::atomic<bool> greedy_meshing = true;
+    std::atomic<EdgeGuess> unknown_edges = EdgeGuess::Predicted;
+    size_t loaded_faces = 0;        // for the debug overlay
+    mutable size_t drawn_faces = 0; // submitted by the last `draw`
 
-    mutable std::unordered_map<Key, std::unique_ptr<Block[]>, Key::Hash>
-        neighbor_cache;
-    std::unordered_map<Key, std::unique_ptr<Block[]>, Key::Hash> block_map;
+    // border layers of generated chunks, the only thing meshing reads
+    // across chunk borders; these up to the mutex are guarded by
+    // `mutex_chunks`
+    std::unordered_map<Key, Chunk::Borders, Key::Hash> border_map;
+    std::unordered_map<Key, std::shared_ptr<Chunk::Data>, Key::Hash>
+        block_map;
+    // chunks past `pending`, set under `mutex_pending` as well when a job
+    // takes one, so that a chunk is never queued while it is generated
+    std::unordered_map<Key, ChunkState, Key::Hash> state_map;
+    // lit chunks whose mesh job waits for their neighbours
+    std::unordered_set<Key, Key::Hash> waiting;
+    mutable std::shared_mutex mutex_chunks;
     std::unordered_map<Key, Chunk::Mesh, Key::Hash> mesh_map;
+    std::unordered_map<Key, MeshLayout, Key::Hash> layout_map;
+    std::unordered_map<Key, AssumedEdges, Key::Hash> assumed_edges;
+    // guessed wrong, meshed again by the workers after this frame's uploads
+    std::unordered_set<Key, Key::Hash> stale_edges;
     std::unordered_set<Key, Key::Hash> loaded_chunks;
 
-    std::vector<FreeSlot> free_slots;
-    GLuint used_vertices = 0;
-
-    std::atomic<Chunk::Key> center_chunk;
-    std::priority_queue<PrioritizedKey> pending_queue;
-    std::unordered_set<Key, Key::Hash> pending_set;
-    std::queue<std::pair<Key, std::vector<Vertex>>> ready;
+    std::atomic<StreamShape> stream_shape = DEFAULT_STREAM_SHAPE;
+    std::atomic<Chunk::Key> center_chunk; // see `clamp_stream_center`
+    // where `update_view` expects the camera soon, its radius is in range
+    // as well
+    std::atomic<Chunk::Key> ahead_chunk;
+    std::atomic<uint32_t> center_epoch = 0; // bumped by `recenter`
+    std::atomic<size_t> cancelled_jobs = 0; // for the debug overlay
+    std::atomic<size_t> generated_chunks = 0; // as well
+    // a `generate_next` job per chunk
+    ChunkQueue pending{STREAM_RADIUS, DEFAULT_STREAM_SHAPE};
+    MpscQueue<std::pair<Key, MeshData>> ready; // meshed by the workers
     std::mutex mutex_pending;
-    std::mutex mutex_ready;
+    // taken from `ready` at once, uploaded within the budget of each frame
+    std::deque<std::pair<Key, MeshData>> uploads;
+    float upload_share = 1.f;
+    double frame_average = UPLOAD_FRAME_TARGET; // seconds, smoothed
+    double last_update = 0.0; // `hi::time` of the last `update`
 
-    std::vector<Chunk::Key> pending_to_request;
-    size_t pending_index = 0;
-    int wave_radius = 0;
-    bool filling_pending = false;
-    Chunk::Key pending_center;
+    // walks the `StreamVolume` offsets around `stream_center`
+    Chunk::Key stream_center{};
+    size_t stream_index = 0;
+    bool streaming = false;
+    bool stream_filled = false; // walked to the end since the last jump
+    // the slabs up to it are queued ahead of `stream_center`
+    Chunk::Key prefetch_center{};
+    // chunks which entered the stream radius and may have left the unload
+    // radius as the center moved since
+    std::deque<Chunk::Key> exposed;
+    std::deque<Chunk::Key> departed;
+    /* All generated chunks, taken a few per frame and queued to unload if
+       out of range. Steps of the center leave only the chunks around it
+       behind, not the ones streamed around a predicted center the camera
+       turned away from. Filled again once empty. */
+    std::vector<Chunk::Key> sweep;
+    float frustum_planes[6][4] = {}; // of the last `update_view`
 
-    std::condition_variable cv;
-    std::atomic<bool> running = true;
-    std::vector<std::thread> workers;
+    // last, so its workers stop before anything they use goes away
+    JobSystem jobs;
 
     Terrain() noexcept;
-    ~Terrain() noexcept;
 
     Terrain(const Terrain &) = delete;
     Terrain &operator=(const Terrain &) = delete;
 
-    void request_chunk(const Key &key, int center_x, int center_y,
-                       int center_z);
-    void upload_ready_chunks();
-    void unload_chunks_not_in(const std::unordered_set<Key, Key::Hash> &active);
+    // false when the chunk is out of range, generated, queued already or
+    // deferred behind the camera
+    bool request_chunk(const Key &key);
+    // meshes a generated chunk again from its blocks
+    void request_remesh(const Key &key);
+    // false when the chunk of the block has not been generated yet
+    bool set_block(int x, int y, int z, Block block) noexcept;
+    /* Applies the edits to copies of their chunks and remeshes the touched
+       sections of them and of their neighbours before returning, so the
+       next frame shows them. Returns the count of edits applied. */
+    unsigned apply_edits(std::span<const BlockEdit> edits) noexcept;
+    // `frame_time` in seconds adapts the budget, see `UPLOAD_MAX_BYTES`
+    void upload_ready_chunks(double frame_time);
+    void unload_all_chunks();
     void draw(const math::mat4x4 projection, const math::mat4x4 view,
               const math::vec3 camera_pos) const noexcept;
-    void update(int center_cx, int center_cy, int center_cz) noexcept;
+    void update() noexcept;
+    /* Moves the stream center to the chunk of the camera. A move by a few
+       chunks only drops the queued chunks of the slabs left behind and
+       streams the slabs ahead; a jump drops all queued chunks out of range
+       and streams from the center. Either way the chunks past the unload
+       radius are unloaded a few per frame. */
+    void recenter(const Key &camera) noexcept;
+    // streams the new volume in from the center
+    void set_stream_shape(StreamShape shape, const Key &camera) noexcept;
+    /* The view pending chunks are ordered by. `velocity` in blocks per
+       second: the chunks on the way of the camera come first, and the ones
+       behind it are loaded within a radius that shrinks the faster it
+       moves, see `ChunkQueue`. */
+    void update_view(const math::mat4x4 projection, const math::mat4x4 view,
+                     const math::vec3 forward,
+                     const math::vec3 velocity) noexcept;
+    // chunks in range and in the last view frustum that have no mesh yet
+    size_t frustum_holes() const noexcept;
+    // drops every mesh and streams the world in again around `center`
+    void reload(const Key &center) noexcept;
 
   private:
-    void bind_vertex_attributes() const noexcept;
-    void generate_mesh_for(const Key &key, const Block *blocks,
-                           std::vector<Vertex> &out) const noexcept;
-    bool allocate_chunk_slot(GLuint count, GLuint &out_offset);
-    void free_chunk_slot(GLuint offset, GLuint count);
-
-    const Block *get_block_at_extended(
-        const Key &center, const Block *blocks, int x, int y, int z,
-        std::unordered_map<Key, std::unique_ptr<Block[]>, Key::Hash>
-            &temp_neighbors) const noexcept;
-    void push_face(std::vector<Vertex> &out, const Block &blk, int gx, int gy,
-                   int gz, int face) const noexcept;
+    // generates the best pending chunk for the current view, a job
+    void generate_next() noexcept;
+    void generate_job(const Key &key) noexcept;
+    // meshes a generated chunk from its blocks, a job
+    void mesh_job(const Key &key) noexcept;
+    // submits mesh jobs for the waiting chunks among `key` and its
+    // neighbours, or among all of them
+    void schedule_meshes(const Key &key) noexcept;
+    void schedule_waiting() noexcept;
+    // called with `mutex_chunks` held
+    bool can_mesh(const Key &key) const noexcept;
+    // within the stream radius of the center or of the predicted center
+    bool in_stream_range(const Key &key,
+                         int radius = STREAM_RADIUS) const noexcept;
+    // true once the chunk of `token` is out of range, see `CancelToken`
+    bool is_cancelled(CancelToken &token) const noexcept;
+    // moves `stream_center` by one chunk along `axis`
+    void step_center(int axis, int sign) noexcept;
+    // queues the slab a step along `axis` has brought into range
+    void expose_slab(const Key &center, int axis, int sign);
+    // queues the slabs on the way from `stream_center` to `ahead`
+    void prefetch(const Key &ahead);
+    // returns its blocks, if any, for the caller to release
+    std::shared_ptr<Chunk::Data> unload_chunk(const Key &key);
+    // with its layout and assumed edges, not from `loaded_chunks`
+    void free_mesh(const Key &key);
+    // moves meshes off the page the arena evacuates, within the budget
+    void compact_faces();
+
+    void generate_mesh_for(const Key &key, const Chunk::Data &chunk,
+                           MeshData &out) const noexcept;
+    /* Appends the `MeshData` ranges of the sections in `sections` and of
+       the edge slices in `edges` (a bit each), in mesh order. */
+    void generate_ranges(const Chunk::Data &chunk,
+                         const Chunk::BorderPlane (&opaque_neighbors)[6],
+                         const Chunk::BorderPlane (&liquid_neighbors)[6],
+                         unsigned sections, unsigned edges,
+                         MeshData &out) const noexcept;
+    // faces straight from column heights, for `Chunk::is_heightfield` rows
+    void generate_heightfield_mesh(const Key &key,
+                                   const Chunk::Heightmap &heights,
+                                   MeshData &out) const noexcept;
+    /* Appends the faces of direction `face` set in `visible`, greedily
+       merged if enabled, and returns their count. `block_at(x, y, z)` gives
+       the block of a face, `ao_at(x, y, z, face)` its corner occlusion. */
+    template <class BlockAt, class AoAt>
+    unsigned emit_faces(int face, const VisibleRows &visible,
+                        const BlockAt &block_at, const AoAt &ao_at,
+                        std::vector<FaceRecord> &out) const noexcept;
+    // issues the draw calls for `count` faces of `mesh` starting at `first`
+    void draw_faces(const Chunk::Mesh &mesh, unsigned first,
+                    unsigned count) const noexcept;
+    // replaces the mesh of a chunk with `mesh`, leaving `slack` empty
+    // records after each range for later edits
+    void upload_mesh(const Key &key, const MeshData &mesh,
+                     unsigned slack = 0);
+    // rewrites one range of a loaded chunk, false if `count` outgrew it
+    bool write_range(const Key &key, int liquid, int face, unsigned range,
+                     const FaceRecord *faces, unsigned count);
+    // meshes the given sections and edge slices of a loaded chunk again
+    void remesh_ranges(const Key &key, unsigned sections, unsigned edges);
+    // the same against the given neighbour layers
+    void remesh_ranges(const Key &key,
+                       const Chunk::BorderPlane (&opaque_neighbors)[6],
+                       const Chunk::BorderPlane (&liquid_neighbors)[6],
+                       unsigned sections, unsigned edges);
+    // meshes a loaded chunk again on the calling thread
+    void remesh_now(const Key &key);
+    // patches the guessed edges between a just uploaded chunk and the
+    // generated chunks around it
+    void settle_edges(const Key &key);
+    /* Marks a loaded chunk in `stale_edges` if `neighbor` differs from
+       what it guessed behind `side`. The side has to be in its
+       `assumed_edges`. */
+    void patch_edge(const Key &key, int side,
+                    const Chunk::Borders &neighbor);
+
+    /* Border layers of the neighbour on side `face` which touch this
+       chunk. Returns false and leaves them alone when the neighbour has not
+       been generated yet. */
+    bool get_neighbor_border(const Key &center, int face,
+                             Chunk::BorderPlane &opaque,
+                             Chunk::BorderPlane &liquid) const noexcept;
+    // `w` x `h` blocks large face; (x, y, z) is its lowest block in chunk
+    void push_quad(std::vector<FaceRecord> &out, const Block &blk,
+                   unsigned x, unsigned y, unsigned z, int face, unsigned w,
+                   unsigned h, unsigned ao) const noexcept;
 };
 
 } // namespace hi
@@ -2,121 +2,413 @@
 
 #include "block_list.hpp"
 
+#include <bit>
+
 namespace hi {
-void Terrain::generate_mesh_for(const Key &key, const Block *blocks,
-                                std::vector<Vertex> &out) const noexcept {
-    const unsigned W = Chunk::WIDTH, H = Chunk::HEIGHT, D = Chunk::DEPTH;
+using PaddedOccupancy = Terrain::PaddedOccupancy;
 
-    std::unordered_map<Key, std::unique_ptr<Block[]>, Key::Hash> temp_neighbors;
+/* Ambient occlusion of the 4 corners of the unit face `face` of (x, y, z),
+   2 bits per corner from BL to TL: 0 - open, 3 - enclosed.
+   Each corner looks at the two side blocks and the diagonal block in front
+   of the face; `occupied(x, y, z)` answers for -1..32 on every axis. */
+template <class Occupied>
+static unsigned face_ao(const Occupied &occupied, unsigned x, unsigned y,
+                        unsigned z, int face) noexcept {
+    constexpr int NORMAL_AXIS[6] = {2, 2, 0, 0, 1, 1};
+    constexpr int CORNER_VERTEX[4] = {0, 1, 2, 5}; // BL, BR, TR, TL
 
-    auto get_block = [&](int x, int y, int z) -> const Block * {
-        return get_block_at_extended(key, blocks, x, y, z, temp_neighbors);
-    };
+    auto solid = [&](const int p[3]) { return occupied(p[0], p[1], p[2]); };
+
+    const int axis = NORMAL_AXIS[face];
+    const int t1 = (axis + 1) % 3, t2 = (axis + 2) % 3;
+    int front[3] = {int(x), int(y), int(z)};
+    front[axis] += (face == 0 || face == 3 || face == 4) ? 1 : -1;
+
+    unsigned ao = 0;
+    for (int c = 0; c < 4; ++c) {
+        const float *corner = &Block::CUBE_POS[face][CORNER_VERTEX[c] * 3];
+        const int d1 = (corner[t1] > 0.5f) ? 1 : -1;
+        const int d2 = (corner[t2] > 0.5f) ? 1 : -1;
+
+        int side1[3] = {front[0], front[1], front[2]};
+        int side2[3] = {front[0], front[1], front[2]};
+        int diagonal[3] = {front[0], front[1], front[2]};
+        side1[t1] += d1;
+        side2[t2] += d2;
+        diagonal[t1] += d1;
+        diagonal[t2] += d2;
 
+        const unsigned s1 = solid(side1), s2 = solid(side2);
+        const unsigned level = (s1 && s2) ? 3 : s1 + s2 + solid(diagonal);
+        ao |= level << (c * 2);
+    }
+    return ao;
+} // face_ao
+
+/* Occupancy padded by one block on every side: rows [z + 1][y + 1],
+   bit x + 1. The padding comes from the neighbours' border layers, so
+   every row sees its own neighbours without leaving the array. Blocks
+   diagonal across two chunk borders are left empty. */
+static void pad_occupancy(const Chunk::Occupancy &own,
+                          const Chunk::BorderPlane (&neighbors)[6],
+                          PaddedOccupancy &padded) noexcept {
+    constexpr unsigned W = Chunk::WIDTH, H = Chunk::HEIGHT, D = Chunk::DEPTH;
+
+    memset(padded, 0, sizeof(padded));
     for (unsigned z = 0; z < D; ++z)
         for (unsigned y = 0; y < H; ++y)
-            for (unsigned x = 0; x < W; ++x) {
-                const Block &blk = blocks[z * W * H + y * W + x];
-                if (blk.block_id() == BlockList::Air.block_id())
-                    continue;
+            padded[z + 1][y + 1] =
+                (uint64_t(own.rows[z][y]) << 1) |
+                uint64_t((neighbors[2].rows[z] >> y) & 1u) |
+                (uint64_t((neighbors[3].rows[z] >> y) & 1u) << (W + 1));
+    for (unsigned z = 0; z < D; ++z) {
+        padded[z + 1][0] = uint64_t(neighbors[5].rows[z]) << 1;
+        padded[z + 1][H + 1] = uint64_t(neighbors[4].rows[z]) << 1;
+    }
+    for (unsigned y = 0; y < H; ++y) {
+        padded[0][y + 1] = uint64_t(neighbors[1].rows[y]) << 1;
+        padded[D + 1][y + 1] = uint64_t(neighbors[0].rows[y]) << 1;
+    }
+} // pad_occupancy
 
-                const int gx = x + key.x * W, // x
-                    gy = y + key.y * H,       // y
-                    gz = z + key.z * D;       // z
+// faces of `blocks` whose neighbour on that side is not set in `hiding`
+static void find_visible_faces(const PaddedOccupancy &blocks,
+                               const PaddedOccupancy &hiding,
+                               Terrain::VisibleFaces &visible) noexcept {
+    for (unsigned z = 0; z < Chunk::DEPTH; ++z)
+        for (unsigned y = 0; y < Chunk::HEIGHT; ++y) {
+            const uint64_t row = blocks[z + 1][y + 1];
+            const uint64_t hide = hiding[z + 1][y + 1];
+            visible[0][z][y] = uint32_t((row & ~hiding[z + 2][y + 1]) >> 1);
+            visible[1][z][y] = uint32_t((row & ~hiding[z][y + 1]) >> 1);
+            visible[2][z][y] = uint32_t((row & ~(hide << 1)) >> 1);
+            visible[3][z][y] = uint32_t((row & ~(hide >> 1)) >> 1);
+            visible[4][z][y] = uint32_t((row & ~hiding[z + 1][y + 2]) >> 1);
+            visible[5][z][y] = uint32_t((row & ~hiding[z + 1][y]) >> 1);
+        }
+} // find_visible_faces
 
-                for (int face = 0; face < 6; ++face) {
-                    const int dx = (face == 2) ? -1 : (face == 3) ? 1 : 0;
-                    const int dy = (face == 5) ? -1 : (face == 4) ? 1 : 0;
-                    const int dz = (face == 1) ? -1 : (face == 0) ? 1 : 0;
-                    const Block *neighbour = get_block(x + dx, y + dy, z + dz);
+// visible opaque and liquid faces of `chunk` against the neighbour layers
+static void find_chunk_faces(const Chunk::Data &chunk,
+                             const Chunk::BorderPlane (&opaque_neighbors)[6],
+                             const Chunk::BorderPlane (&liquid_neighbors)[6],
+                             PaddedOccupancy &opaque,
+                             Terrain::VisibleFaces &opaque_visible,
+                             Terrain::VisibleFaces &liquid_visible) noexcept {
+    PaddedOccupancy liquid, filled;
+    pad_occupancy(chunk.voxels->opaque, opaque_neighbors, opaque);
+    pad_occupancy(chunk.voxels->liquid, liquid_neighbors, liquid);
 
-                    const uint16_t neighbour_id = neighbour->block_id();
-                    constexpr uint16_t air_id = BlockList::Air.block_id();
-                    constexpr uint16_t water_id = BlockList::Water.block_id();
-                    if (neighbour && (neighbour_id != air_id))
-                        continue;
+    // opaque faces show through air and liquids
+    find_visible_faces(opaque, opaque, opaque_visible);
 
-                    push_face(out, blk, gx, gy, gz, face);
-                }
+    // liquid surfaces show only towards air
+    for (unsigned z = 0; z < Chunk::DEPTH + 2; ++z)
+        for (unsigned y = 0; y < Chunk::HEIGHT + 2; ++y)
+            filled[z][y] = opaque[z][y] | liquid[z][y];
+    find_visible_faces(liquid, filled, liquid_visible);
+} // find_chunk_faces
+
+// moves the faces of the outermost slice on side `face` into `edge`
+static void take_edge_slice(int face, Terrain::VisibleRows &visible,
+                            Terrain::VisibleRows &edge) noexcept {
+    constexpr unsigned W = Chunk::WIDTH, H = Chunk::HEIGHT, D = Chunk::DEPTH;
+    for (unsigned z = 0; z < D; ++z)
+        for (unsigned y = 0; y < H; ++y) {
+            uint32_t mask;
+            switch (face) {
+            case 0:
+                mask = (z == D - 1) ? ~0u : 0u;
+                break;
+            case 1:
+                mask = (z == 0) ? ~0u : 0u;
+                break;
+            case 2:
+                mask = 1u;
+                break;
+            case 3:
+                mask = 1u << (W - 1);
+                break;
+            case 4:
+                mask = (y == H - 1) ? ~0u : 0u;
+                break;
+            case 5:
+            default:
+                mask = (y == 0) ? ~0u : 0u;
+                break;
             }
-}
+            edge[z][y] = visible[z][y] & mask;
+            visible[z][y] &= ~mask;
+        }
+} // take_edge_slice
 
-const Block *Terrain::get_block_at_extended(
-    const Key &center, const Block *blocks, int x, int y, int z,
-    std::unordered_map<Key, std::unique_ptr<Block[]>, Key::Hash>
-        &temp_neighbors) const noexcept {
-    const int W = Chunk::WIDTH, H = Chunk::HEIGHT, D = Chunk::DEPTH;
+// copies the rows of one `Chunk::SECTIONS` section, false if it is empty
+static bool take_section(unsigned section, const Terrain::VisibleRows &visible,
+                         Terrain::VisibleRows &out) noexcept {
+    constexpr unsigned H = Chunk::SECTION_HEIGHT;
+    memset(out, 0, sizeof(out));
+    uint32_t any = 0;
+    for (unsigned z = 0; z < Chunk::DEPTH; ++z)
+        for (unsigned y = section * H; y < section * H + H; ++y) {
+            out[z][y] = visible[z][y];
+            any |= visible[z][y];
+        }
+    return any != 0;
+} // take_section
 
-    if (x >= 0 && x < W && y >= 0 && y < H && z >= 0 && z < D)
-        return &blocks[z * W * H + y * W + x];
+void Terrain::generate_mesh_for(const Key &key, const Chunk::Data &chunk,
+                                MeshData &out) const noexcept {
+    const EdgeGuess guess = unknown_edges.load(std::memory_order_relaxed);
 
-    int nx = x, ny = y, nz = z;
-    Key nk = center;
+    Chunk::BorderPlane opaque_neighbors[6], liquid_neighbors[6];
+    for (int face = 0; face < 6; ++face) {
+        Chunk::BorderPlane &opaque = opaque_neighbors[face];
+        Chunk::BorderPlane &liquid = liquid_neighbors[face];
+        if (get_neighbor_border(key, face, opaque, liquid))
+            continue;
 
-    if (nx < 0) {
-        nk.x--;
-        nx += W;
-    } else if (nx >= W) {
-        nk.x++;
-        nx -= W;
-    }
-    if (ny < 0) {
-        nk.y--;
-        ny += H;
-    } else if (ny >= H) {
-        nk.y++;
-        ny -= H;
+        // not generated yet: mesh against a guess, patched on arrival
+        if (guess == EdgeGuess::Predicted) {
+            Chunk::predict_border_plane(key.y, chunk.heights, face, opaque,
+                                        liquid);
+        } else {
+            memset(&opaque, guess == EdgeGuess::Solid ? 0xFF : 0x00,
+                   sizeof(opaque));
+            memset(&liquid, 0x00, sizeof(liquid));
+        }
+        out.assumed_sides |= 1u << face;
+        out.assumed.opaque[face] = opaque;
+        out.assumed.liquid[face] = liquid;
     }
-    if (nz < 0) {
-        nk.z--;
-        nz += D;
-    } else if (nz >= D) {
-        nk.z++;
-        nz -= D;
+
+    generate_ranges(chunk, opaque_neighbors, liquid_neighbors,
+                    /* sections */ (1u << Chunk::SECTIONS) - 1u,
+                    /* edges    */ 0x3Fu, out);
+    out.sectioned = true;
+}
+
+void Terrain::generate_ranges(const Chunk::Data &chunk,
+                              const Chunk::BorderPlane (&opaque_neighbors)[6],
+                              const Chunk::BorderPlane (&liquid_neighbors)[6],
+                              unsigned sections, unsigned edges,
+                              MeshData &out) const noexcept {
+    PaddedOccupancy opaque;
+    VisibleFaces visible[2]; // opaque, liquid
+    find_chunk_faces(chunk, opaque_neighbors, liquid_neighbors, opaque,
+                     visible[0], visible[1]);
+
+    auto block_at = [&](unsigned x, unsigned y, unsigned z) {
+        return chunk.voxels->blocks[Chunk::calculate_block_index(x, y, z)];
+    };
+    auto opaque_at = [&](int x, int y, int z) {
+        return unsigned(opaque[z + 1][y + 1] >> (x + 1)) & 1u;
+    };
+    auto opaque_ao = [&](unsigned x, unsigned y, unsigned z, int face) {
+        return face_ao(opaque_at, x, y, z, face);
+    };
+    auto no_ao = [](unsigned, unsigned, unsigned, int) { return 0u; };
+    auto emit = [&](int liquid, int face, const VisibleRows &rows) {
+        return liquid ? emit_faces(face, rows, block_at, no_ao, out.faces)
+                      : emit_faces(face, rows, block_at, opaque_ao, out.faces);
+    };
+
+    VisibleRows edge, rows;
+    out.liquid_count = 0;
+    for (int liquid = 0; liquid < 2; ++liquid)
+        for (int face = 0; face < 6; ++face) {
+            unsigned *counts = out.range_counts[liquid][face];
+            unsigned total = 0;
+            take_edge_slice(face, visible[liquid][face], edge);
+            for (unsigned section = 0; section < Chunk::SECTIONS; ++section) {
+                if (!((sections >> section) & 1u))
+                    continue;
+                counts[section] =
+                    take_section(section, visible[liquid][face], rows)
+                        ? emit(liquid, face, rows)
+                        : 0;
+                total += counts[section];
+            }
+            if ((edges >> face) & 1u) {
+                counts[Chunk::SECTIONS] = emit(liquid, face, edge);
+                total += counts[Chunk::SECTIONS];
+            }
+
+            if (liquid)
+                out.liquid_count += total;
+            else
+                out.direction_counts[face] = total;
+        }
+}
+
+void Terrain::generate_heightfield_mesh(const Key &key,
+                                        const Chunk::Heightmap &heights,
+                                        MeshData &out) const noexcept {
+    constexpr unsigned W = Chunk::WIDTH, H = Chunk::HEIGHT, D = Chunk::DEPTH;
+    const int base = key.y * int(H);
+
+    /* Each column shows its top face and, towards every lower neighbour
+       column, the wall between the two heights. Nothing is visible from
+       below: the ground goes on under the chunk. */
+    VisibleFaces visible = {};
+    constexpr int SIDE_DX[4] = {0, 0, -1, 1}; // z+, z-, x-, x+
+    constexpr int SIDE_DZ[4] = {1, -1, 0, 0};
+    for (unsigned z = 0; z < D; ++z)
+        for (unsigned x = 0; x < W; ++x) {
+            const int top = heights.top(x, z) - base;
+            if (top < 0)
+                continue;
+            const uint32_t bit = 1u << x;
+            if (top < int(H))
+                visible[4][z][top] |= bit;
+
+            const int highest = std::min(top, int(H) - 1);
+            for (int face = 0; face < 4; ++face) {
+                const int side =
+                    heights.top(x + SIDE_DX[face], z + SIDE_DZ[face]) - base;
+                for (int y = std::max(side + 1, 0); y <= highest; ++y)
+                    visible[face][z][y] |= bit;
+            }
+        }
+
+    auto block_at = [&](unsigned x, unsigned y, unsigned z) {
+        const int *row = heights.heights[z + 1];
+        return Chunk::column_block(base + int(y), row[x + 1]);
+    };
+    auto ground_at = [&](int x, int y, int z) {
+        return unsigned(base + y <= heights.top(x, z));
+    };
+
+    auto ground_ao = [&](unsigned x, unsigned y, unsigned z, int face) {
+        return face_ao(ground_at, x, y, z, face);
+    };
+
+    for (int face = 0; face < 6; ++face)
+        out.direction_counts[face] =
+            emit_faces(face, visible[face], block_at, ground_ao, out.faces);
+    out.liquid_count = 0;
+}
+
+template <class BlockAt, class AoAt>
+unsigned Terrain::emit_faces(int face, const VisibleRows &visible,
+                             const BlockAt &block_at, const AoAt &ao_at,
+                             std::vector<FaceRecord> &out) const noexcept {
+    constexpr unsigned H = Chunk::HEIGHT, D = Chunk::DEPTH;
+    const size_t first = out.size();
+
+    if (!greedy_meshing.load(std::memory_order_relaxed)) {
+        for (unsigned z = 0; z < D; ++z)
+            for (unsigned y = 0; y < H; ++y)
+                for (uint32_t bits = visible[z][y]; bits; bits &= bits - 1) {
+                    const unsigned x = std::countr_zero(bits);
+                    push_quad(out, block_at(x, y, z), x, y, z, face, 1, 1,
+                              ao_at(x, y, z, face));
+                }
+        return out.size() - first;
     }
 
-    auto it = block_map.find(nk);
-    const Block *neighbor = nullptr;
-
-    if (it != block_map.end()) {
-        neighbor = it->second.get();
-    } else {
-        auto cache_it = neighbor_cache.find(nk);
-        if (cache_it == neighbor_cache.end()) {
-            auto tmp = std::make_unique<Block[]>(Chunk::BLOCKS_PER_CHUNK);
-            Chunk::generate_chunk(nk.x, nk.y, nk.z, tmp.get(), noise);
-            neighbor = tmp.get();
-            neighbor_cache.emplace(nk, std::move(tmp));
+    /* Greedy merging, one slice at a time. In a slice the grid axes are the
+       face's texture axes: `a` runs along u, `b` along v (see FACE_UVS).
+         z faces: slice z, a = x, b = y
+         x faces: slice x, a = z, b = y
+         y faces: slice y, a = x, b = z */
+    auto to_xyz = [](int face, unsigned slice, unsigned a, unsigned b,
+                     unsigned &x, unsigned &y, unsigned &z) {
+        if (face < 2) {
+            x = a, y = b, z = slice;
+        } else if (face < 4) {
+            x = slice, y = b, z = a;
         } else {
-            neighbor = cache_it->second.get();
+            x = a, y = slice, z = b;
+        }
+    };
+
+    for (unsigned slice = 0; slice < 32; ++slice) {
+        uint32_t mask[32];
+        uint32_t any = 0;
+        for (unsigned b = 0; b < 32; ++b) {
+            if (face < 2) {
+                mask[b] = visible[slice][b];
+            } else if (face < 4) {
+                uint32_t bits = 0;
+                for (unsigned a = 0; a < 32; ++a)
+                    bits |= ((visible[a][b] >> slice) & 1u) << a;
+                mask[b] = bits;
+            } else {
+                mask[b] = visible[b][slice];
+            }
+            any |= mask[b];
         }
+        if (!any)
+            continue;
+
+        // faces merge only when block id, texture, light and AO match
+        auto key_at = [&](unsigned a, unsigned b) {
+            unsigned x, y, z;
+            to_xyz(face, slice, a, b, x, y, z);
+            const Block blk = block_at(x, y, z);
+            return (uint64_t(ao_at(x, y, z, face)) << 32) |
+                   (uint32_t(blk.flags) << 16) | blk.id;
+        };
+
+        for (unsigned b = 0; b < 32; ++b)
+            while (mask[b]) {
+                const unsigned a = std::countr_zero(mask[b]);
+                const uint64_t merge_key = key_at(a, b);
+
+                unsigned w = 1;
+                while (a + w < 32 && ((mask[b] >> (a + w)) & 1u) &&
+                       key_at(a + w, b) == merge_key)
+                    ++w;
+                const uint32_t run = (w == 32) ? ~0u : (((1u << w) - 1u) << a);
+
+                unsigned h = 1;
+                for (; b + h < 32; ++h) {
+                    if ((mask[b + h] & run) != run)
+                        break;
+                    unsigned i = 0;
+                    while (i < w && key_at(a + i, b + h) == merge_key)
+                        ++i;
+                    if (i != w)
+                        break;
+                }
+
+                for (unsigned i = 0; i < h; ++i)
+                    mask[b + i] &= ~run;
+
+                unsigned x, y, z;
+                to_xyz(face, slice, a, b, x, y, z);
+                push_quad(out, block_at(x, y, z), x, y, z, face, w, h,
+                          uint32_t(merge_key >> 32));
+            }
     }
+    return out.size() - first;
+}
+
+bool Terrain::get_neighbor_border(const Key &center, int face,
+                                  Chunk::BorderPlane &opaque,
+                                  Chunk::BorderPlane &liquid) const noexcept {
+    const Key nk = Chunk::neighbor_key(center, face);
+    const int opposite = face ^ 1; // the neighbour's layer facing us
 
-    return &neighbor[nz * W * H + ny * W + nx];
+    std::shared_lock lk(mutex_chunks);
+    auto it = border_map.find(nk);
+    if (it == border_map.end())
+        return false;
+    opaque = it->second.opaque[opposite];
+    liquid = it->second.liquid[opposite];
+    return true;
 }
 
-void Terrain::push_face(std::vector<Vertex> &out, const Block &blk, int gx,
-                        int gy, int gz, int face) const noexcept {
+void Terrain::push_quad(std::vector<FaceRecord> &out, const Block &blk,
+                        unsigned x, unsigned y, unsigned z, int face,
+                        unsigned w, unsigned h, unsigned ao) const noexcept {
     using Tex = Block::TextureProtocol;
 
-    constexpr int TPR = TEXTUREPACK_ATLAS_WIDTH / Tex::RESOLUTION;
-
     uint32_t bid = blk.block_id() - 1;
     uint32_t off = Tex::resolve_offset(blk.texture_protocol(), face);
 
-    uint32_t tex = bid + off;
-    uint32_t tx = tex % TPR, ty = tex / TPR;
-
-    for (int i = 0; i < 6; ++i) {
-        Vertex v;
-        const float *POS = Block::CUBE_POS[face];
-        v.position_block[0] = gx + POS[i * 3 + 0];
-        v.position_block[1] = gy + POS[i * 3 + 1];
-        v.position_block[2] = gz + POS[i * 3 + 2];
-        v.position_block[3] = blk.to_float();
-        v.uv[0] = (tx + Block::FACE_UVS[i * 2 + 0]) / float(TPR);
-        v.uv[1] = (ty + Block::FACE_UVS[i * 2 + 1]) / float(TPR);
-        out.push_back(v);
-    }
+    out.push_back(FaceRecord{
+        FaceRecord::make_position_size(x, y, z, face, w, h),
+        FaceRecord::make_tile_light(bid + off, blk.light(), ao)});
 }
-} // namespace hi
\ No newline at end of file
+} // namespace hi
@@ -19,11 +19,15 @@ struct World {
     Terrain terrain;
 
     int center_cx = -9999, center_cy = -9999, center_cz = -9999;
+    math::vec3 last_position{};
+    math::vec3 velocity{}; // blocks per second
 
     World() noexcept : camera{}, terrain{} {
         camera.position[0] = 0.f;
         camera.position[1] = 100.f;
         camera.position[2] = 0.f;
+        math::vec3_dup(last_position, camera.position);
+        camera.look_at(view);
         update_pos();
     }
 
@@ -38,7 +42,64 @@ struct World {
         camera.look_at(view);
     }
 
-    void update() noexcept { terrain.update(center_cx, center_cy, center_cz); }
+    // tracks the camera velocity, smoothed over a few frames
+    void track_motion(double delta_time) noexcept {
+        if (delta_time <= 0.0)
+            return;
+        const float blend = std::min(1.f, float(delta_time) * 8.f);
+        for (int i = 0; i < 3; ++i) {
+            const float step = (camera.position[i] - last_position[i]) /
+                               float(delta_time);
+            velocity[i] += (step - velocity[i]) * blend;
+            last_position[i] = camera.position[i];
+        }
+    }
+
+    void update() noexcept {
+        terrain.update_view(projection, view, camera.front, velocity);
+        terrain.update();
+    }
+
+    void toggle_greedy_meshing() noexcept {
+        terrain.greedy_meshing = !terrain.greedy_meshing;
+        terrain.reload(Chunk::Key{center_cx, center_cy, center_cz});
+    }
+
+    void cycle_stream_shape() noexcept {
+        const auto next = StreamShape((int(terrain.stream_shape.load()) + 1) %
+                                      (int(StreamShape::Cylinder) + 1));
+        terrain.set_stream_shape(next,
+                                 Chunk::Key{center_cx, center_cy, center_cz});
+    }
+
+    void change_worker_count(int delta) noexcept {
+        const int count = int(terrain.jobs.worker_count()) + delta;
+        terrain.jobs.set_worker_count(unsigned(std::max(count, 1)));
+    }
+
+    void cycle_worker_priority() noexcept {
+        const auto next =
+            ThreadPriority((int(terrain.jobs.priority()) + 1) %
+                           (int(ThreadPriority::Idle) + 1));
+        terrain.jobs.set_priority(next);
+    }
+
+    // all CPUs, all but the first one, the first half of them
+    void cycle_worker_affinity() noexcept {
+        const unsigned cpus = std::min(terrain.jobs.max_workers(), 64u);
+        if (cpus < 2)
+            return;
+        const unsigned long long all =
+            cpus == 64 ? ~0ull : (1ull << cpus) - 1;
+        const unsigned long long half = (1ull << (cpus + 1) / 2) - 1;
+        const unsigned long long mask = terrain.jobs.affinity();
+        if (!mask)
+            terrain.jobs.set_affinity(all & ~1ull);
+        else if (mask == (all & ~1ull))
+            terrain.jobs.set_affinity(half);
+        else
+            terrain.jobs.set_affinity(0);
+    }
 
     void draw() const noexcept {
         terrain.draw(projection, view, camera.position);
@@ -60,13 +121,7 @@ struct World {
         center_cy = cy;
         center_cz = cz;
 
-        terrain.center_chunk.store(Chunk::Key{cx, cy, cz});
-
-        terrain.pending_to_request.clear();
-        terrain.pending_index = 0;
-        terrain.wave_radius = 0;
-        terrain.filling_pending = true;
-        terrain.pending_center = Chunk::Key{cx, cy, cz};
+        terrain.recenter(Chunk::Key{cx, cy, cz});
     }
 };
 